@@ -0,0 +1,148 @@
+/***************************************************
+ * rans -- interleaved range asymmetric numeral    *
+ *         system coding of in-memory byte blocks  *
+ ***************************************************/
+
+#include <string.h>
+
+#include "ans/rans.h"
+
+void ransNormalize(const huff_freq_t* freqs, int n, unsigned int* norm){
+    unsigned long long total = 0;
+    int i, sum = 0;
+
+    for( i=0; i<n; i++ ) total += freqs[i];
+    if (!total) { memset(norm, 0, n * sizeof(unsigned int)); return; }
+
+    for( i=0; i<n; i++ ){
+        norm[i] = 0;
+        if (!freqs[i]) continue;
+        norm[i] = (unsigned long long) freqs[i] * RANS_SCALE / total;
+        if (!norm[i]) norm[i] = 1;
+        sum += norm[i];
+    }
+
+    // rounding and the minimum of 1 can leave the sum off, take it from
+    // (or give it to) the biggest symbols, which lose the least by it
+    while (sum != RANS_SCALE){
+        int big = -1;
+        for( i=0; i<n; i++ )
+            if (norm[i] > 1 && (big < 0 || norm[i] > norm[big])) big = i;
+        if (big < 0) for( i=0; i<n; i++ ) if (norm[i]) { big = i; break; }
+
+        if (sum > RANS_SCALE){
+            int d = sum - RANS_SCALE;
+            if (d > (int) norm[big] - 1) d = norm[big] - 1;
+            norm[big] -= d;
+            sum -= d;
+        } else {
+            norm[big] += RANS_SCALE - sum;
+            sum = RANS_SCALE;
+        }
+    }
+}
+
+static inline int ransPut(unsigned int* x, unsigned char** p, const unsigned char* limit, unsigned int start, unsigned int freq){
+    unsigned int max = ((RANS_L >> RANS_SCALE_BITS) << 8) * freq;
+    unsigned int state = *x;
+    if (*p - limit < 2) return -1;
+    while (state >= max){
+        *--(*p) = state & 0xff;
+        state >>= 8;
+    }
+    *x = ((state / freq) << RANS_SCALE_BITS) + (state % freq) + start;
+    return 0;
+}
+
+static inline void ransFlush(unsigned int x, unsigned char** p){
+    *--(*p) = x >> 24;
+    *--(*p) = x >> 16;
+    *--(*p) = x >> 8;
+    *--(*p) = x;
+}
+
+size_t ransEncode(const unsigned char* src, size_t n, const huff_freq_t* freqs, unsigned char* dst, size_t capacity){
+    unsigned int norm[RANS_R], start[RANS_R];
+    BitWriter w;
+    int s;
+
+    ransNormalize(freqs, RANS_R, norm);
+    for( s=0; s<RANS_R; s++ ) start[s] = s ? start[s-1] + norm[s-1] : 0;
+
+    initBitWriter(&w, dst, capacity);
+    for( s=0; s<RANS_R; s++ ){
+        putBits(&w, norm[s] != 0, 1);
+        if (norm[s]) putBits(&w, norm[s] - 1, RANS_SCALE_BITS);
+    }
+    size_t header = flushBits(&w);
+    if (w.overflow || header + 8 > capacity) return 0;
+
+    // symbols are coded backwards, so that they can be decoded forwards
+    const unsigned char* limit = dst + header + 8;
+    unsigned char* end = dst + capacity;
+    unsigned char* p = end;
+    unsigned int x[2] = { RANS_L, RANS_L };
+    size_t i;
+    for( i=n; i>0; i-- ){
+        int symbol = src[i-1];
+        if (ransPut(&x[(i-1) & 1], &p, limit, start[symbol], norm[symbol])) return 0;
+    }
+    ransFlush(x[1], &p);
+    ransFlush(x[0], &p);
+
+    size_t stream = end - p;
+    memmove(dst + header, p, stream);
+    return header + stream;
+}
+
+static inline unsigned int get32(const unsigned char* p){
+    return p[0] | p[1] << 8 | p[2] << 16 | (unsigned int) p[3] << 24;
+}
+
+int ransDecode(const unsigned char* src, size_t size, unsigned char* dst, size_t n){
+    unsigned int norm[RANS_R], start[RANS_R];
+    unsigned char slots[RANS_SCALE];
+    BitReader r;
+    size_t bits = 0;
+    int s, sum = 0;
+
+    initBitReader(&r, src, size);
+    for( s=0; s<RANS_R; s++ ){
+        norm[s] = getBits(&r, 1) ? getBits(&r, RANS_SCALE_BITS) + 1 : 0;
+        bits += norm[s] ? 1 + RANS_SCALE_BITS : 1;
+        start[s] = sum;
+        sum += norm[s];
+        if (sum > RANS_SCALE) return -1;
+    }
+    if (sum != RANS_SCALE && n) return -1;
+    for( s=0; s<RANS_R; s++ ) memset(slots + start[s], s, norm[s]);
+
+    size_t header = (bits + 7) / 8;
+    if (header + 8 > size) return -1;
+    const unsigned char* p = src + header;
+    const unsigned char* end = src + size;
+    unsigned int x0 = get32(p), x1 = get32(p + 4);
+    p += 8;
+
+    // symbols alternate between the two states, one step of each per round
+#define STEP(x, i) {                                                    \
+        unsigned int slot = x & (RANS_SCALE - 1);                       \
+        int symbol = slots[slot];                                       \
+        dst[i] = symbol;                                                \
+        x = norm[symbol] * (x >> RANS_SCALE_BITS) + slot - start[symbol]; \
+        while (x < RANS_L){                                             \
+            if (p == end) return -1;                                    \
+            x = (x << 8) | *p++;                                        \
+        }                                                               \
+    }
+    size_t i;
+    for( i=0; i+2<=n; i+=2 ){
+        STEP(x0, i);
+        STEP(x1, i+1);
+    }
+    if (i < n) STEP(x0, i);
+#undef STEP
+
+    // states go back to where encoder started only for intact input
+    return x0 == RANS_L && x1 == RANS_L && p == end ? 0 : -1;
+}
@@ -0,0 +1,45 @@
+/***************************************************
+ * rans -- interleaved range asymmetric numeral    *
+ *         system coding of in-memory byte blocks  *
+ *                                                 *
+ * Takes the same histogram as the Huffman coder,  *
+ * normalizes it to RANS_SCALE and codes symbols   *
+ * with two interleaved 32-bit states, so a symbol *
+ * can cost a fraction of a bit. Decoding is one   *
+ * table lookup per symbol.                        *
+ *                                                 *
+ * Payload: frequency table (bit per symbol, then  *
+ *          12 bits of frequency-1 if present),    *
+ *          two states, rANS byte stream           *
+ ***************************************************/
+
+#ifndef RANS_H
+#define RANS_H
+
+#include <stddef.h>
+
+#include "huff/huffman.h"
+
+#define RANS_SCALE_BITS 12
+#define RANS_SCALE (1<<RANS_SCALE_BITS)
+#define RANS_L (1u<<23)
+#define RANS_R 256
+
+/*
+    Scales frequencies of n symbols to sum to RANS_SCALE,
+    keeping every present symbol at least 1.
+*/
+void ransNormalize(const huff_freq_t* freqs, int n, unsigned int* norm);
+
+/*
+    Encodes n bytes with the given histogram of them.
+    Returns payload size, 0 if it does not fit in capacity.
+*/
+size_t ransEncode(const unsigned char* src, size_t n, const huff_freq_t* freqs, unsigned char* dst, size_t capacity);
+
+/*
+    Decodes exactly n bytes, returns 0 or -1 on corrupted input.
+*/
+int ransDecode(const unsigned char* src, size_t size, unsigned char* dst, size_t n);
+
+#endif
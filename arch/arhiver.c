@@ -0,0 +1,603 @@
+/*****************************************************
+ * arhiver -- program to pack many files into one    *
+ *            compressed archive and back            *
+ *                                                   *
+ * Usage:                                            *
+ *      arhiver c [-m method] [-b block] [-j n]      *
+ *              archive path...                      *
+ *          - method: stored, huff, lzh, rans, bwt   *
+ *            huff16 (16 bit samples) or auto        *
+ *            (default), which picks one per block   *
+ *          - block: block size in bytes             *
+ *          - n: number of threads                   *
+ *          - path: files or directories to pack     *
+ *      arhiver x [-j n] [-C dir] archive [name...]  *
+ *          - dir: where to extract                  *
+ *          - name: files (or directories) to        *
+ *                  extract, everything if none      *
+ *      arhiver l archive                            *
+ *                                                   *
+ * Small files are batched into shared blocks, big   *
+ * ones split into blocks of their own. Blocks are   *
+ * compressed on a work-stealing pool and written in *
+ * completion order, the central directory at the    *
+ * end maps files to blocks.                         *
+ *                                                   *
+ * File:      "ARH1" block* directory footer         *
+ * directory: u32 blocks, (u64 offset, u32 size,     *
+ *            u32 original size)*, u32 files,        *
+ *            (u16 length, path, u64 size,           *
+ *            u32 first block, u32 offset in it)*    *
+ * footer:    u64 directory offset, "ARH1"           *
+ * All integers are little endian.                   *
+ *****************************************************/
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <dirent.h>
+#include <errno.h>
+#include <pthread.h>
+#include <sys/stat.h>
+
+#include "block/block.h"
+#include "common/pool.h"
+
+#define MAGIC "ARH1"
+#define FOOTER 12
+#define DEFAULT_BLOCK (1<<20)
+#define MAX_BLOCK (1<<30)
+
+typedef struct Entry {
+    char* name;                 // path inside the archive
+    char* source;               // path on disk
+    unsigned long long size;
+    unsigned int block;         // first block
+    unsigned int offset;        // offset in first block
+    int selected;
+} Entry;
+
+/*
+    Part of a block: len bytes of entry from its offset `from`,
+    placed at offset `at` of the block.
+*/
+typedef struct Segment {
+    int entry;
+    unsigned int block;
+    unsigned long long from;
+    unsigned int at;
+    unsigned int len;
+} Segment;
+
+typedef struct BlockInfo {
+    unsigned long long offset;  // in archive
+    unsigned int size;          // encoded
+    unsigned int original;
+    int firstSegment;
+    int segments;
+} BlockInfo;
+
+typedef struct Archive {
+    Entry* entries;
+    int nEntries, capEntries;
+    BlockInfo* blocks;
+    int nBlocks, capBlocks;
+    Segment* segments;
+    int nSegments, capSegments;
+
+    int method;
+    unsigned int blockSize;
+    int threads;
+
+    int fd;
+    unsigned long long end;     // where next block goes
+    pthread_mutex_t lock;
+    unsigned char** in;         // per worker buffers
+    unsigned char** out;
+    int* needed;                // first segment of each block to extract
+    const char* dir;            // extraction directory
+    int error;                  // set by pool workers too, see fail
+} Archive;
+
+// little endian helpers
+
+static void put16(FILE* f, unsigned int x){
+    fputc(x, f); fputc(x >> 8, f);
+}
+
+static void put32(FILE* f, unsigned int x){
+    put16(f, x); put16(f, x >> 16);
+}
+
+static void put64(FILE* f, unsigned long long x){
+    put32(f, x); put32(f, x >> 32);
+}
+
+static unsigned int get16(const unsigned char* p){
+    return p[0] | p[1] << 8;
+}
+
+static unsigned int get32(const unsigned char* p){
+    return get16(p) | get16(p + 2) << 16;
+}
+
+static unsigned long long get64(const unsigned char* p){
+    return get32(p) | (unsigned long long) get32(p + 4) << 32;
+}
+
+// building the layout
+
+static void* grow(void* array, int* capacity, int count, size_t item){
+    if (count < *capacity) return array;
+    *capacity = *capacity ? 2 * *capacity : 64;
+    return realloc(array, *capacity * item);
+}
+
+static Entry* addEntry(Archive* a){
+    a->entries = (Entry*) grow(a->entries, &a->capEntries, a->nEntries, sizeof(Entry));
+    Entry* e = &a->entries[a->nEntries++];
+    memset(e, 0, sizeof(Entry));
+    return e;
+}
+
+static int addBlock(Archive* a){
+    a->blocks = (BlockInfo*) grow(a->blocks, &a->capBlocks, a->nBlocks, sizeof(BlockInfo));
+    BlockInfo* b = &a->blocks[a->nBlocks];
+    memset(b, 0, sizeof(BlockInfo));
+    b->firstSegment = a->nSegments;
+    return a->nBlocks++;
+}
+
+static void addSegment(Archive* a, int entry, unsigned long long from, unsigned int len){
+    a->segments = (Segment*) grow(a->segments, &a->capSegments, a->nSegments, sizeof(Segment));
+    BlockInfo* b = &a->blocks[a->nBlocks - 1];
+    Segment* s = &a->segments[a->nSegments++];
+    s->entry = entry;
+    s->block = a->nBlocks - 1;
+    s->from = from;
+    s->at = b->original;
+    s->len = len;
+    b->original += len;
+    b->segments++;
+}
+
+static int byName(const void* x, const void* y){
+    return strcmp(*(char* const*) x, *(char* const*) y);
+}
+
+/*
+    Adds a regular file, or everything under a directory (in name order).
+*/
+static void addPath(Archive* a, const char* path){
+    struct stat st;
+    if (lstat(path, &st)){
+        fprintf(stderr, "Can not read %s\n", path);
+        a->error = 1;
+        return;
+    }
+
+    if (S_ISREG(st.st_mode)){
+        Entry* e = addEntry(a);
+        const char* name = path;
+        while (*name == '/' || (name[0] == '.' && name[1] == '/')) name += *name == '/' ? 1 : 2;
+        e->name = strdup(name);
+        e->source = strdup(path);
+        e->size = st.st_size;
+        return;
+    }
+    if (!S_ISDIR(st.st_mode)) return;
+
+    DIR* dir = opendir(path);
+    if (!dir) { a->error = 1; return; }
+    char** names = NULL;
+    int n = 0, cap = 0;
+    struct dirent* d;
+    while( (d = readdir(dir)) ){
+        if (!strcmp(d->d_name, ".") || !strcmp(d->d_name, "..")) continue;
+        names = (char**) grow(names, &cap, n, sizeof(char*));
+        names[n++] = strdup(d->d_name);
+    }
+    closedir(dir);
+    qsort(names, n, sizeof(char*), byName);
+
+    int i;
+    for( i=0; i<n; i++ ){
+        size_t len = strlen(path) + strlen(names[i]) + 2;
+        char* child = (char*) malloc(len);
+        snprintf(child, len, "%s%s%s", path, path[strlen(path)-1] == '/' ? "" : "/", names[i]);
+        addPath(a, child);
+        free(child);
+        free(names[i]);
+    }
+    free(names);
+}
+
+/*
+    Files smaller than a block are batched together and never cross a block
+    boundary; bigger files start on a fresh block and are split into full ones.
+*/
+static void layout(Archive* a){
+    int i, batch = -1;
+    for( i=0; i<a->nEntries; i++ ){
+        Entry* e = &a->entries[i];
+        if (e->size == 0) continue;
+
+        if (e->size >= a->blockSize){
+            unsigned long long from;
+            batch = -1;
+            for( from=0; from<e->size; from+=a->blockSize ){
+                int b = addBlock(a);
+                if (!from) { e->block = b; e->offset = 0; }
+                unsigned long long len = e->size - from;
+                addSegment(a, i, from, len < a->blockSize ? len : a->blockSize);
+            }
+            continue;
+        }
+
+        if (batch < 0 || a->blocks[batch].original + e->size > a->blockSize) batch = addBlock(a);
+        e->block = batch;
+        e->offset = a->blocks[batch].original;
+        addSegment(a, i, 0, e->size);
+    }
+}
+
+// compression
+
+static void fail(Archive* a){
+    __atomic_store_n(&a->error, 1, __ATOMIC_RELAXED);
+}
+
+static void compressBlock(void* arg, int task, int worker){
+    Archive* a = (Archive*) arg;
+    BlockInfo* b = &a->blocks[task];
+    unsigned char* in = a->in[worker];
+    unsigned char* out = a->out[worker];
+    int k;
+
+    for( k=0; k<b->segments; k++ ){
+        Segment* s = &a->segments[b->firstSegment + k];
+        int fd = open(a->entries[s->entry].source, O_RDONLY);
+        ssize_t got = fd < 0 ? -1 : pread(fd, in + s->at, s->len, s->from);
+        if (fd >= 0) close(fd);
+        if (got != (ssize_t) s->len){
+            fprintf(stderr, "Can not read %s\n", a->entries[s->entry].source);
+            fail(a);
+            return;
+        }
+    }
+
+    size_t size = blockEncode(a->method, in, b->original, out);
+
+    pthread_mutex_lock(&a->lock);
+    b->offset = a->end;
+    b->size = size;
+    a->end += size;
+    pthread_mutex_unlock(&a->lock);
+
+    if (pwrite(a->fd, out, size, b->offset) != (ssize_t) size) fail(a);
+}
+
+static void allocateBuffers(Archive* a, size_t size){
+    int i;
+    a->in = (unsigned char**) malloc(a->threads * sizeof(unsigned char*));
+    a->out = (unsigned char**) malloc(a->threads * sizeof(unsigned char*));
+    for( i=0; i<a->threads; i++ ){
+        a->in[i] = (unsigned char*) malloc(size);
+        a->out[i] = (unsigned char*) malloc(blockBound(size));
+    }
+}
+
+static void freeBuffers(Archive* a){
+    int i;
+    for( i=0; i<a->threads; i++ ){
+        free(a->in[i]);
+        free(a->out[i]);
+    }
+    free(a->in);
+    free(a->out);
+}
+
+static int create(Archive* a, const char* path, char** inputs, int n){
+    int i;
+    for( i=0; i<n; i++ ) addPath(a, inputs[i]);
+    if (a->error) return -1;
+    layout(a);
+
+    FILE* f = fopen(path, "wb");
+    if (!f) { fprintf(stderr, "Can not create %s\n", path); return -1; }
+    fwrite(MAGIC, 1, 4, f);
+    fflush(f);
+
+    a->fd = fileno(f);
+    a->end = 4;
+    pthread_mutex_init(&a->lock, NULL);
+    allocateBuffers(a, a->blockSize);
+    poolRun(a->threads, a->nBlocks, compressBlock, a);
+    freeBuffers(a);
+    pthread_mutex_destroy(&a->lock);
+
+    // central directory
+    fseek(f, a->end, SEEK_SET);
+    put32(f, a->nBlocks);
+    for( i=0; i<a->nBlocks; i++ ){
+        put64(f, a->blocks[i].offset);
+        put32(f, a->blocks[i].size);
+        put32(f, a->blocks[i].original);
+    }
+    put32(f, a->nEntries);
+    for( i=0; i<a->nEntries; i++ ){
+        Entry* e = &a->entries[i];
+        size_t len = strlen(e->name);
+        put16(f, len);
+        fwrite(e->name, 1, len, f);
+        put64(f, e->size);
+        put32(f, e->block);
+        put32(f, e->offset);
+    }
+    put64(f, a->end);
+    fwrite(MAGIC, 1, 4, f);
+    if (fclose(f)) a->error = 1;
+
+    return a->error ? -1 : 0;
+}
+
+// reading
+
+static int load(Archive* a, const char* path){
+    a->fd = open(path, O_RDONLY);
+    if (a->fd < 0) { fprintf(stderr, "Can not open %s\n", path); return -1; }
+
+    struct stat st;
+    unsigned char footer[FOOTER];
+    if (fstat(a->fd, &st) || st.st_size < 4 + FOOTER
+            || pread(a->fd, footer, FOOTER, st.st_size - FOOTER) != FOOTER
+            || memcmp(footer + 8, MAGIC, 4)) {
+        fprintf(stderr, "%s is not an archive\n", path);
+        return -1;
+    }
+
+    unsigned long long start = get64(footer);
+    if (start < 4 || start > (unsigned long long) st.st_size - FOOTER) return -1;
+    size_t size = st.st_size - FOOTER - start;
+    unsigned char* dir = (unsigned char*) malloc(size);
+    if (pread(a->fd, dir, size, start) != (ssize_t) size) { free(dir); return -1; }
+
+    // every read below is checked against the end of directory
+    unsigned char* p = dir;
+    unsigned char* end = dir + size;
+    int i, error = 0;
+
+#define NEED(n) if ((size_t) (end - p) < (size_t) (n)) { error = 1; break; }
+    do {
+        NEED(4);
+        int blocks = get32(p); p += 4;
+        NEED((size_t) blocks * 16);
+        for( i=0; i<blocks; i++ ){
+            int b = addBlock(a);
+            a->blocks[b].offset = get64(p);
+            a->blocks[b].size = get32(p + 8);
+            a->blocks[b].original = get32(p + 12);
+            p += 16;
+        }
+        NEED(4);
+        int entries = get32(p); p += 4;
+        for( i=0; i<entries && !error; i++ ){
+            NEED(2);
+            size_t len = get16(p); p += 2;
+            NEED(len + 16);
+            Entry* e = addEntry(a);
+            e->name = strndup((char*) p, len); p += len;
+            e->size = get64(p);
+            e->block = get32(p + 8);
+            e->offset = get32(p + 12);
+            p += 16;
+        }
+    } while (0);
+#undef NEED
+
+    free(dir);
+    if (error) fprintf(stderr, "Corrupted archive directory\n");
+    return error ? -1 : 0;
+}
+
+static void list(Archive* a){
+    int i;
+    for( i=0; i<a->nEntries; i++ )
+        printf("%12llu  %s\n", a->entries[i].size, a->entries[i].name);
+}
+
+// extraction
+
+static int selects(const char* name, char** names, int n){
+    int i;
+    if (!n) return 1;
+    for( i=0; i<n; i++ ){
+        size_t len = strlen(names[i]);
+        while (len && names[i][len-1] == '/') len--;
+        if (!strncmp(name, names[i], len) && (name[len] == '\0' || name[len] == '/')) return 1;
+    }
+    return 0;
+}
+
+static int safe(const char* name){
+    const char* p = name;
+    if (*name == '/' || !*name) return 0;
+    while (p){
+        if (p[0] == '.' && p[1] == '.' && (p[2] == '/' || p[2] == '\0')) return 0;
+        p = strchr(p, '/');
+        if (p) p++;
+    }
+    return 1;
+}
+
+static char* outputPath(Archive* a, const char* name){
+    size_t len = strlen(a->dir) + strlen(name) + 2;
+    char* path = (char*) malloc(len);
+    snprintf(path, len, "%s/%s", a->dir, name);
+    return path;
+}
+
+static void makeParents(char* path){
+    char* p;
+    for( p=path+1; *p; p++ ){
+        if (*p != '/') continue;
+        *p = '\0';
+        if (mkdir(path, 0755) && errno != EEXIST) { *p = '/'; return; }
+        *p = '/';
+    }
+}
+
+/*
+    Splits selected entries into segments of the blocks they are stored in.
+*/
+static int segmentEntries(Archive* a){
+    int i;
+    for( i=0; i<a->nEntries; i++ ){
+        Entry* e = &a->entries[i];
+        if (!e->selected || !e->size) continue;
+        unsigned long long from = 0;
+        unsigned int block = e->block, at = e->offset;
+        while (from < e->size){
+            if (block >= (unsigned) a->nBlocks || at > a->blocks[block].original) return -1;
+            unsigned long long len = e->size - from;
+            if (len > a->blocks[block].original - at) len = a->blocks[block].original - at;
+            if (!len) return -1;
+            a->segments = (Segment*) grow(a->segments, &a->capSegments, a->nSegments, sizeof(Segment));
+            Segment* s = &a->segments[a->nSegments++];
+            s->entry = i;
+            s->block = block;
+            s->from = from;
+            s->at = at;
+            s->len = len;
+            from += len;
+            block++;
+            at = 0;
+        }
+    }
+    return 0;
+}
+
+static int bySegment(const void* x, const void* y){
+    const Segment* s = (const Segment*) x;
+    const Segment* t = (const Segment*) y;
+    if (s->block != t->block) return s->block < t->block ? -1 : 1;
+    return s->at < t->at ? -1 : s->at > t->at;
+}
+
+static void extractBlock(void* arg, int task, int worker){
+    Archive* a = (Archive*) arg;
+    BlockInfo* b = &a->blocks[a->segments[a->needed[task]].block];
+    unsigned char* in = a->in[worker];
+    unsigned char* out = a->out[worker];
+    int k;
+
+    if (pread(a->fd, in, b->size, b->offset) != (ssize_t) b->size
+            || blockDecode(in, b->size, out, b->original)){
+        fprintf(stderr, "Corrupted block at %llu\n", b->offset);
+        fail(a);
+        return;
+    }
+
+    for( k=0; k<b->segments; k++ ){
+        Segment* s = &a->segments[b->firstSegment + k];
+        int fd = open(a->entries[s->entry].source, O_WRONLY);
+        ssize_t put = fd < 0 ? -1 : pwrite(fd, out + s->at, s->len, s->from);
+        if (fd >= 0) close(fd);
+        if (put != (ssize_t) s->len) fail(a);
+    }
+}
+
+static int extract(Archive* a, char** names, int n){
+    int i;
+    for( i=0; i<a->nEntries; i++ ){
+        Entry* e = &a->entries[i];
+        e->selected = selects(e->name, names, n);
+        if (!e->selected) continue;
+        if (!safe(e->name)) { fprintf(stderr, "Skipping unsafe path %s\n", e->name); e->selected = 0; continue; }
+
+        e->source = outputPath(a, e->name);
+        makeParents(e->source);
+        int fd = open(e->source, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        if (fd < 0 || ftruncate(fd, e->size)) { fprintf(stderr, "Can not create %s\n", e->source); return -1; }
+        close(fd);
+    }
+    if (segmentEntries(a)) { fprintf(stderr, "Corrupted archive directory\n"); return -1; }
+
+    // group segments by block, only blocks with selected data are decoded
+    qsort(a->segments, a->nSegments, sizeof(Segment), bySegment);
+    a->needed = (int*) malloc((a->nSegments + 1) * sizeof(int));
+    int tasks = 0;
+    size_t biggest = 1;
+    for( i=0; i<a->nSegments; i++ ){
+        BlockInfo* b = &a->blocks[a->segments[i].block];
+        if (i && a->segments[i-1].block == a->segments[i].block) { b->segments++; continue; }
+        b->firstSegment = i;
+        b->segments = 1;
+        a->needed[tasks++] = i;
+        if (b->size > biggest) biggest = b->size;
+        if (b->original > biggest) biggest = b->original;
+    }
+
+    allocateBuffers(a, biggest);
+    poolRun(a->threads, tasks, extractBlock, a);
+    freeBuffers(a);
+    free(a->needed);
+
+    return a->error ? -1 : 0;
+}
+
+int main(int argc, char *argv[]){
+    if (argc < 3 || strlen(argv[1]) != 1 || !strchr("cxl", argv[1][0])){
+        fprintf(stderr, "Have to provide command and archive.\n"
+                        "Example: %s c [-m method] [-b block] [-j threads] archive path...\n"
+                        "         %s x [-j threads] [-C dir] archive [name...]\n"
+                        "         %s l archive\n", argv[0], argv[0], argv[0]);
+        return 0;
+    }
+
+    Archive a;
+    memset(&a, 0, sizeof(a));
+    a.method = BLOCK_AUTO;
+    a.blockSize = DEFAULT_BLOCK;
+    a.threads = poolThreads();
+    a.dir = ".";
+    a.fd = -1;
+
+    char command = argv[1][0];
+    int opt;
+    optind = 2;
+    while( (opt = getopt(argc, argv, "m:b:j:C:")) != -1 ){
+        switch (opt) {
+            case 'm': a.method = blockMethod(optarg);   break;
+            case 'b': a.blockSize = atol(optarg);       break;
+            case 'j': a.threads = atoi(optarg);         break;
+            case 'C': a.dir = optarg;                   break;
+            default: return -1;
+        }
+    }
+    if (a.method < 0 || a.blockSize == 0 || a.blockSize > MAX_BLOCK || a.threads < 1 || optind >= argc){
+        fprintf(stderr, "Invalid options\n");
+        return -1;
+    }
+    const char* path = argv[optind++];
+
+    int error;
+    if (command == 'c'){
+        if (optind == argc) { fprintf(stderr, "Nothing to pack\n"); return -1; }
+        fprintf(stderr, "Packing...\n");
+        error = create(&a, path, argv + optind, argc - optind);
+    } else {
+        error = load(&a, path);
+        if (!error && command == 'l') list(&a);
+        if (!error && command == 'x'){
+            fprintf(stderr, "Unpacking...\n");
+            error = extract(&a, argv + optind, argc - optind);
+        }
+    }
+    if (command != 'l') fprintf(stderr, error ? "Failed!\n" : "Done!\n");
+
+    return error ? -1 : 0;
+}
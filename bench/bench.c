@@ -0,0 +1,213 @@
+/*****************************************************
+ * bench -- program to benchmark every codec on a    *
+ *          fixed, generated corpus                  *
+ *                                                   *
+ * Usage:                                            *
+ *      bench [-b bindir] [-r repeats] [-s scale]    *
+ *          - bindir: directory with built codecs    *
+ *          - repeats: runs per measurement (best)   *
+ *          - scale: corpus size multiplier          *
+ *                                                   *
+ * Report (JSON) is written to standard output.      *
+ *****************************************************/
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <sys/resource.h>
+
+#include "bench/corpus.h"
+
+#define MAX_ARGS 16
+#define PATH_LEN 4096
+
+/*
+    Codec is described by the command lines of its encoder and decoder.
+    Placeholders: %i input, %o output, %t table file (if codec has one).
+*/
+typedef struct codec_t {
+    const char* name;
+    const char* encode[MAX_ARGS];
+    const char* decode[MAX_ARGS];
+    int table;
+} Codec;
+
+static const Codec codecs[] = {
+    { "huff",     { "huffkoder",     "%i", "%t", "%o", NULL }, { "huffdekoder", "%t", "%i", "%o", NULL }, 1 },
+    { "lzw",      { "lzwkoder",      "%i", "%o", NULL },       { "lzwdekoder",  "%i", "%o", NULL },       0 },
+    { "list_lzw", { "list_lzwkoder", "%i", "%o", NULL },       { "lzwdekoder",  "%i", "%o", NULL },       0 },
+    { "lzh",      { "lzhkoder",      "%i", "%o", NULL },       { "lzhdekoder",  "%i", "%o", NULL },       0 },
+    { "block_lzh",  { "blockkoder", "-m", "lzh",  "%i", "%o", NULL }, { "blockdekoder", "%i", "%o", NULL }, 0 },
+    { "block_rans", { "blockkoder", "-m", "rans", "%i", "%o", NULL }, { "blockdekoder", "%i", "%o", NULL }, 0 },
+    { "block_bwt",  { "blockkoder", "-m", "bwt",  "%i", "%o", NULL }, { "blockdekoder", "%i", "%o", NULL }, 0 },
+    { "block_huff16", { "blockkoder", "-m", "huff16", "%i", "%o", NULL }, { "blockdekoder", "%i", "%o", NULL }, 0 },
+    { "block_auto", { "blockkoder", "-m", "auto", "%i", "%o", NULL }, { "blockdekoder", "%i", "%o", NULL }, 0 },
+};
+#define CODECS ((int) (sizeof(codecs) / sizeof(codecs[0])))
+
+typedef struct run_t {
+    double seconds;
+    long peakKB;
+    int status;
+} Run;
+
+// helpers
+
+static double now(){
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static long fileSize(const char* path){
+    struct stat st;
+    if (stat(path, &st)) return -1;
+    return st.st_size;
+}
+
+static int sameFiles(const char* a, const char* b){
+    FILE* fa = fopen(a, "rb");
+    FILE* fb = fopen(b, "rb");
+    int same = fa && fb;
+    char ba[1<<14], bb[1<<14];
+    while( same ){
+        size_t na = fread(ba, 1, sizeof(ba), fa);
+        size_t nb = fread(bb, 1, sizeof(bb), fb);
+        if (na != nb || memcmp(ba, bb, na)) same = 0;
+        if (!na) break;
+    }
+    if (fa) fclose(fa);
+    if (fb) fclose(fb);
+    return same;
+}
+
+/*
+    Runs one command (template + substitutions) and measures wall time
+    and peak resident memory of the child process.
+*/
+static Run run(const char* bindir, const char* const* tmpl, const char* in, const char* table, const char* out){
+    char program[PATH_LEN];
+    char* argv[MAX_ARGS];
+    int i;
+
+    snprintf(program, sizeof(program), "%s/%s", bindir, tmpl[0]);
+    argv[0] = program;
+    for( i=1; tmpl[i]; i++ ){
+        if      (!strcmp(tmpl[i], "%i")) argv[i] = (char*) in;
+        else if (!strcmp(tmpl[i], "%o")) argv[i] = (char*) out;
+        else if (!strcmp(tmpl[i], "%t")) argv[i] = (char*) table;
+        else                             argv[i] = (char*) tmpl[i];
+    }
+    argv[i] = NULL;
+
+    Run r = { 0, 0, -1 };
+    double start = now();
+    pid_t pid = fork();
+    if (pid == 0){
+        int devnull = open("/dev/null", O_WRONLY);
+        dup2(devnull, STDOUT_FILENO);
+        dup2(devnull, STDERR_FILENO);
+        execv(program, argv);
+        _exit(127);
+    }
+    if (pid < 0) return r;
+
+    int status;
+    struct rusage usage;
+    wait4(pid, &status, 0, &usage);
+    r.seconds = now() - start;
+    r.peakKB  = usage.ru_maxrss;
+    r.status  = WIFEXITED(status) ? WEXITSTATUS(status) : -1;
+    return r;
+}
+
+static Run best(const char* bindir, const char* const* tmpl, const char* in, const char* table, const char* out, int repeats){
+    Run b = run(bindir, tmpl, in, table, out);
+    while( --repeats > 0 ){
+        Run r = run(bindir, tmpl, in, table, out);
+        if (r.status != b.status) { b.status = r.status; break; }
+        if (r.seconds < b.seconds) b.seconds = r.seconds;
+        if (r.peakKB > b.peakKB) b.peakKB = r.peakKB;
+    }
+    return b;
+}
+
+static double mbps(long size, double seconds){
+    return seconds > 0 ? size / (double) MiB / seconds : 0;
+}
+
+int main(int argc, char *argv[]){
+    const char* bindir = "bin";
+    int repeats = 3;
+    double scale = 1;
+
+    int opt;
+    while( (opt = getopt(argc, argv, "b:r:s:")) != -1 ){
+        switch (opt) {
+            case 'b': bindir  = optarg;       break;
+            case 'r': repeats = atoi(optarg); break;
+            case 's': scale   = atof(optarg); break;
+            default:
+                fprintf(stderr, "Usage: %s [-b bindir] [-r repeats] [-s scale]\n", argv[0]);
+                return -1;
+        }
+    }
+    if (repeats < 1) repeats = 1;
+
+    char dir[] = "/tmp/benchXXXXXX";
+    if (!mkdtemp(dir)){
+        fprintf(stderr, "Can not create working directory\n");
+        return -1;
+    }
+
+    char in[PATH_LEN], table[PATH_LEN], out[PATH_LEN], back[PATH_LEN];
+    snprintf(table, sizeof(table), "%s/table", dir);
+    snprintf(out,   sizeof(out),   "%s/compressed", dir);
+    snprintf(back,  sizeof(back),  "%s/decompressed", dir);
+
+    printf("{\n  \"repeats\": %d,\n  \"scale\": %g,\n  \"results\": [", repeats, scale);
+    int first = 1, failed = 0;
+    int c, k;
+    for( c=0; c<CORPUS; c++ ){
+        snprintf(in, sizeof(in), "%s/%s", dir, corpus[c].name);
+        FILE* f = fopen(in, "wb");
+        generateCorpus(&corpus[c], scale, f);
+        fclose(f);
+        long original = fileSize(in);
+
+        for( k=0; k<CODECS; k++ ){
+            fprintf(stderr, "%s / %s\n", corpus[c].name, codecs[k].name);
+            Run enc = best(bindir, codecs[k].encode, in, table, out, repeats);
+            Run dec = best(bindir, codecs[k].decode, out, table, back, repeats);
+
+            long compressed = fileSize(out);
+            if (codecs[k].table) compressed += fileSize(table);
+            int ok = enc.status == 0 && dec.status == 0 && sameFiles(in, back);
+            failed += !ok;
+
+            printf("%s\n    {\"codec\": \"%s\", \"file\": \"%s\", \"size\": %ld, \"compressed\": %ld, "
+                   "\"ratio\": %.4f, \"compress_mbps\": %.3f, \"decompress_mbps\": %.3f, "
+                   "\"compress_peak_rss_kb\": %ld, \"decompress_peak_rss_kb\": %ld, \"roundtrip\": %s}",
+                first ? "" : ",", codecs[k].name, corpus[c].name, original, compressed,
+                original ? compressed / (double) original : 0,
+                mbps(original, enc.seconds), mbps(original, dec.seconds),
+                enc.peakKB, dec.peakKB, ok ? "true" : "false");
+            first = 0;
+
+            unlink(out);
+            unlink(back);
+            unlink(table);
+        }
+        unlink(in);
+    }
+    printf("\n  ],\n  \"failed\": %d\n}\n", failed);
+    rmdir(dir);
+
+    return failed ? 1 : 0;
+}
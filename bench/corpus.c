@@ -0,0 +1,206 @@
+/*****************************************************
+ * corpus -- fixed, generated benchmark corpus       *
+ *****************************************************/
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "bench/corpus.h"
+
+// deterministic generator, corpus must be the same between versions
+
+#define SEED 88172645463325252ULL
+
+static unsigned long long rng = SEED;
+
+static unsigned long long next(){
+    rng ^= rng << 13;
+    rng ^= rng >> 7;
+    rng ^= rng << 17;
+    return rng;
+}
+
+static const char* syllables[] = {
+    "ka", "ri", "mo", "ne", "tu", "la", "po", "si", "de", "vo",
+    "an", "el", "ir", "om", "us", "ja", "ko", "zi", "ba", "gre"
+};
+
+/*
+    Text with a Zipf-like word distribution over a fixed vocabulary.
+*/
+static void genText(FILE* out, size_t size){
+    char vocab[1024][16];
+    int i, j;
+    for( i=0; i<1024; i++ ){
+        int n = 1 + next() % 4;
+        vocab[i][0] = '\0';
+        for( j=0; j<n; j++ ) strcat(vocab[i], syllables[next() % 20]);
+    }
+
+    size_t written = 0;
+    int col = 0;
+    while( written < size ){
+        double u = (next() % 1000000) / 1000000.0;
+        const char* w = vocab[(int) (1024 * u * u * u)];
+        int len = strlen(w);
+        fputs(w, out);
+        written += len;
+        col += len;
+        char sep = (next() % 12 == 0) ? '.' : ' ';
+        if (col > 72) { sep = '\n'; col = 0; }
+        fputc(sep, out);
+        written++;
+    }
+}
+
+static void genLogs(FILE* out, size_t size){
+    static const char* levels[] = { "INFO", "INFO", "INFO", "DEBUG", "WARN", "ERROR" };
+    static const char* paths[]  = { "items", "users", "orders", "health", "search" };
+    size_t written = 0;
+    long ms = 0;
+    while( written < size ){
+        ms += next() % 50;
+        int n = fprintf(out,
+            "2016-01-12 %02ld:%02ld:%02ld.%03ld [%s] worker-%d: request id=%08llx path=/api/v1/%s/%llu status=%d latency=%llums\n",
+            (ms / 3600000) % 24, (ms / 60000) % 60, (ms / 1000) % 60, ms % 1000,
+            levels[next() % 6], (int) (next() % 8), next() & 0xffffffffULL,
+            paths[next() % 5], next() % 10000, next() % 20 ? 200 : 500, next() % 300);
+        written += n;
+    }
+}
+
+/*
+    Fixed-width records, like a typical binary dump.
+*/
+static void genBinary(FILE* out, size_t size){
+    struct { unsigned int id; unsigned short type; unsigned short flags; double value; char pad[8]; } rec;
+    memset(&rec, 0, sizeof(rec));
+    size_t written = 0;
+    double v = 100.0;
+    while( written < size ){
+        rec.id++;
+        rec.type = next() % 7;
+        rec.flags = (next() % 4 == 0) ? 0x8001 : 0;
+        v += ((long long) (next() % 2001) - 1000) / 1000.0;
+        rec.value = v;
+        fwrite(&rec, sizeof(rec), 1, out);
+        written += sizeof(rec);
+    }
+}
+
+static void genRandom(FILE* out, size_t size){
+    size_t i;
+    for( i=0; i<size; i++ ) fputc(next() & 0xff, out);
+}
+
+static void genZeros(FILE* out, size_t size){
+    size_t i;
+    for( i=0; i<size; i++ ) fputc(0, out);
+}
+
+/*
+    One byte value makes up over 90% of the data, the rest are a few others.
+*/
+static void genSkewed(FILE* out, size_t size){
+    size_t i;
+    for( i=0; i<size; i++ ){
+        int r = next() % 100;
+        fputc(r < 92 ? 'A' : r < 96 ? 'B' : r < 98 ? 'C' : 'D' + (int) (next() % 8), out);
+    }
+}
+
+/*
+    Logs with already compressed payloads in between, like an archive
+    of a directory with JPEGs and gzip files next to the text.
+*/
+static void genMixed(FILE* out, size_t size){
+    size_t written = 0, i;
+    while( written < size ){
+        long start = ftell(out);
+        genLogs(out, 40 << 10);
+        written += ftell(out) - start;
+        size_t payload = (64 + next() % 448) << 10;
+        for( i=0; i<payload; i++ ) fputc(next() >> 56, out);
+        written += payload;
+    }
+}
+
+/*
+    16 bit little endian samples of a 12 bit sensor that sits at one of a few
+    set points with some noise, and moves to another one now and then.
+*/
+static void genSensor(FILE* out, size_t size){
+    int points[8], i, point = 0;
+    size_t k;
+    for( i=0; i<8; i++ ) points[i] = 256 + next() % 3584;
+    for( k=0; k+2<=size; k+=2 ){
+        if (next() % 2000 == 0) point = next() % 8;
+        int sample = points[point] + (int) (next() % 9) + (int) (next() % 9) - 8;
+        fputc(sample & 0xff, out);
+        fputc(sample >> 8, out);
+    }
+}
+
+static void genSmall(FILE* out, size_t size){
+    if (size > 64) genLogs(out, size);
+    else           genText(out, size);
+}
+
+const Corpus corpus[] = {
+    { "text",      MiB,   genText,   0 },
+    { "logs",      MiB,   genLogs,   0 },
+    { "binary",    MiB,   genBinary, 0 },
+    { "random",    MiB,   genRandom, 0 },
+    { "zeros",     MiB,   genZeros,  0 },
+    { "skewed",    MiB,   genSkewed, SEED + 5 },
+    { "mixed",     4*MiB, genMixed,  SEED + 6 },
+    { "small_1k",  1024,  genSmall,  0 },
+    { "small_64",  64,    genSmall,  0 },
+    { "sensor",    MiB,   genSensor, SEED + 9 },
+};
+const int CORPUS = sizeof(corpus) / sizeof(corpus[0]);
+
+static size_t scaled(const Corpus* c, double scale){
+    return c->size >= MiB ? (size_t) (c->size * scale) : c->size;
+}
+
+/*
+    Files of the first corpus were drawn one after another from a single
+    stream starting at SEED, so each one starts where the one before it
+    (at the same scale) left off. Those states are found once per scale
+    by generating the files before it into nothing.
+*/
+static unsigned long long streamState(const Corpus* c, double scale){
+    static unsigned long long states[sizeof(corpus) / sizeof(corpus[0])];
+    static double statesScale = -1;
+    int i;
+
+    if (scale != statesScale){
+        FILE* sink = fopen("/dev/null", "w");
+        rng = SEED;
+        for( i=0; i<CORPUS; i++ ){
+            if (corpus[i].seed) continue;
+            states[i] = rng;
+            corpus[i].generate(sink, scaled(&corpus[i], scale));
+        }
+        fclose(sink);
+        statesScale = scale;
+    }
+    return states[c - corpus];
+}
+
+void generateCorpus(const Corpus* c, double scale, FILE* out){
+    // every file gets the same data no matter which ones were generated before
+    rng = c->seed ? c->seed : streamState(c, scale);
+    c->generate(out, scaled(c, scale));
+}
+
+unsigned char* loadCorpus(const Corpus* c, double scale, size_t* size){
+    char* data = NULL;
+    FILE* f = open_memstream(&data, size);
+    generateCorpus(c, scale, f);
+    fclose(f);
+    return (unsigned char*) data;
+}
@@ -0,0 +1,33 @@
+/*****************************************************
+ * corpus -- fixed, generated benchmark corpus       *
+ *                                                   *
+ * text, logs, binary records, random, zeros, one    *
+ * dominant byte, a few small files and 16 bit       *
+ * sensor samples.                                   *
+ *****************************************************/
+
+#ifndef CORPUS_H
+#define CORPUS_H
+
+#include <stdio.h>
+
+#define MiB (1<<20)
+
+typedef struct corpus_t {
+    const char* name;
+    size_t size; // for scale 1, files under 1 MiB are never scaled
+    void (*generate)(FILE* out, size_t size);
+    unsigned long long seed; // 0 for files of the first corpus, see generateCorpus
+} Corpus;
+
+extern const Corpus corpus[];
+extern const int CORPUS;
+
+void generateCorpus(const Corpus* c, double scale, FILE* out);
+
+/*
+    Generates corpus file into a malloc'd buffer.
+*/
+unsigned char* loadCorpus(const Corpus* c, double scale, size_t* size);
+
+#endif
@@ -0,0 +1,120 @@
+/*****************************************************
+ * entropybench -- program to compare byte entropy   *
+ *                 coders (Huffman and rANS) on the  *
+ *                 benchmark corpus, in memory       *
+ *                                                   *
+ * Usage:                                            *
+ *      entropybench [-b block] [-s scale]           *
+ *          - block: block size in bytes             *
+ *          - scale: corpus size multiplier          *
+ *                                                   *
+ * Report (JSON) is written to standard output.      *
+ *****************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "bench/corpus.h"
+#include "block/block.h"
+
+#define MIN_SECONDS 0.25
+
+static const int methods[] = { BLOCK_HUFF, BLOCK_RANS };
+#define METHODS ((int) (sizeof(methods) / sizeof(methods[0])))
+
+static double now(){
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+typedef struct Encoded {
+    unsigned char* data;
+    size_t* sizes;    // encoded size of each block
+    size_t total;
+} Encoded;
+
+static void encodeAll(int method, const unsigned char* src, size_t n, size_t block, Encoded* e){
+    size_t pos, b = 0;
+    e->total = 0;
+    for( pos=0; pos<n; pos+=block, b++ ){
+        size_t len = n - pos < block ? n - pos : block;
+        e->sizes[b] = blockEncode(method, src + pos, len, e->data + e->total);
+        e->total += e->sizes[b];
+    }
+}
+
+static int decodeAll(const Encoded* e, unsigned char* dst, size_t n, size_t block){
+    size_t pos, b = 0, at = 0;
+    int error = 0;
+    for( pos=0; pos<n; pos+=block, b++ ){
+        size_t len = n - pos < block ? n - pos : block;
+        error |= blockDecode(e->data + at, e->sizes[b], dst + pos, len);
+        at += e->sizes[b];
+    }
+    return error;
+}
+
+int main(int argc, char *argv[]){
+    size_t block = 1<<16;
+    double scale = 1;
+
+    int opt;
+    while( (opt = getopt(argc, argv, "b:s:")) != -1 ){
+        switch (opt) {
+            case 'b': block = atol(optarg); break;
+            case 's': scale = atof(optarg); break;
+            default:
+                fprintf(stderr, "Usage: %s [-b block] [-s scale]\n", argv[0]);
+                return -1;
+        }
+    }
+    if (block < 1) block = 1;
+
+    printf("{\n  \"block\": %zu,\n  \"results\": [", block);
+    int c, m, first = 1, failed = 0;
+    for( c=0; c<CORPUS; c++ ){
+        size_t n;
+        unsigned char* src = loadCorpus(&corpus[c], scale, &n);
+        unsigned char* back = (unsigned char*) malloc(n + 1);
+        size_t blocks = (n + block - 1) / block;
+        Encoded e;
+        e.data = (unsigned char*) malloc(blocks + n + 1);
+        e.sizes = (size_t*) malloc((blocks + 1) * sizeof(size_t));
+
+        for( m=0; m<METHODS; m++ ){
+            int runs = 0;
+            double start = now(), encodeTime, decodeTime;
+            do { encodeAll(methods[m], src, n, block, &e); runs++; }
+            while ((encodeTime = now() - start) < MIN_SECONDS);
+            encodeTime /= runs;
+
+            runs = 0;
+            int error = 0;
+            start = now();
+            do { error |= decodeAll(&e, back, n, block); runs++; }
+            while ((decodeTime = now() - start) < MIN_SECONDS);
+            decodeTime /= runs;
+
+            int ok = !error && !memcmp(src, back, n);
+            failed += !ok;
+            printf("%s\n    {\"codec\": \"%s\", \"file\": \"%s\", \"size\": %zu, \"compressed\": %zu, "
+                   "\"ratio\": %.4f, \"compress_mbps\": %.3f, \"decompress_mbps\": %.3f, \"roundtrip\": %s}",
+                first ? "" : ",", blockMethodName(methods[m]), corpus[c].name, n, e.total,
+                n ? e.total / (double) n : 0, n / (double) MiB / encodeTime, n / (double) MiB / decodeTime,
+                ok ? "true" : "false");
+            first = 0;
+        }
+
+        free(e.data);
+        free(e.sizes);
+        free(back);
+        free(src);
+    }
+    printf("\n  ],\n  \"failed\": %d\n}\n", failed);
+
+    return failed ? 1 : 0;
+}
@@ -0,0 +1,243 @@
+/*****************************************************
+ * kernelbench -- program to compare the generated   *
+ *                Huffman and LZW kernels with the   *
+ *                hand-written coders, in memory     *
+ *                                                   *
+ * Usage:                                            *
+ *      kernelbench [-b block] [-s scale]            *
+ *          - block: block size in bytes             *
+ *          - scale: corpus size multiplier          *
+ *                                                   *
+ * huff is a hand-written loop over huffPut and      *
+ * huffGet of huff/huffman.h, the block format of    *
+ * the kernels (no pair tables, no stored blocks),   *
+ * lzw is lzw/lzw.c with raw 16 bit codes, lzw_auto  *
+ * picks the code width per block. Report            *
+ * (JSON) is written to standard output, with the    *
+ * speed of huff8 relative to huff over all files.   *
+ *****************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "bench/corpus.h"
+#include "huff/huffkernels.h"
+#include "huff/huffman.h"
+#include "lzw/lzw.h"
+#include "lzw/lzwkernels.h"
+
+#define R 256
+#define MIN_SECONDS 0.25
+
+typedef struct Codec {
+    const char* name;
+    int bits;           // width of the kernel, symbol or code
+    size_t (*encode)(const struct Codec* c, void* work, const unsigned char* src, size_t n, unsigned char* dst, size_t capacity);
+    int (*decode)(const struct Codec* c, void* work, const unsigned char* src, size_t size, unsigned char* dst, size_t n);
+} Codec;
+
+typedef struct HuffTables {
+    huff_freq_t freqs[R];
+    unsigned char lengths[R];
+    HuffEncoder encoder;
+    HuffDecoder decoder;
+} HuffTables;
+
+static size_t huffEncode(const Codec* c, void* work, const unsigned char* src, size_t n, unsigned char* dst, size_t capacity){
+    HuffTables* t = (HuffTables*) work;
+    BitWriter w;
+    size_t i;
+
+    huffHistogram(src, n, t->freqs);
+    huffLengths(t->freqs, R, HUFF_MAX_BITS, t->lengths);
+    huffBuildEncoder(&t->encoder, t->lengths, R);
+    initBitWriter(&w, dst, capacity);
+    huffWriteLengths(&w, t->lengths, R);
+    for( i=0; i<n && !w.overflow; i++ ) huffPut(&w, &t->encoder, src[i]);
+    size_t size = flushBits(&w);
+    return w.overflow ? 0 : size;
+}
+
+static int huffDecode(const Codec* c, void* work, const unsigned char* src, size_t size, unsigned char* dst, size_t n){
+    HuffTables* t = (HuffTables*) work;
+    BitReader r;
+    size_t i;
+
+    initBitReader(&r, src, size);
+    if (huffReadLengths(&r, t->lengths, R) || huffBuildDecoder(&t->decoder, t->lengths, R)) return -1;
+    for( i=0; i<n; i++ ){
+        int symbol = huffGet(&r, &t->decoder);
+        if (symbol < 0) return -1;
+        dst[i] = symbol;
+    }
+    return overrun(&r) ? -1 : 0;
+}
+
+static size_t huffKernelEncode(const Codec* c, void* work, const unsigned char* src, size_t n, unsigned char* dst, size_t capacity){
+    return huffKernel(c->bits)->encode(work, src, n / (c->bits / 8), dst, capacity);
+}
+
+static int huffKernelDecode(const Codec* c, void* work, const unsigned char* src, size_t size, unsigned char* dst, size_t n){
+    return huffKernel(c->bits)->decode(work, src, size, dst, n / (c->bits / 8));
+}
+
+static size_t lzwEncodeRaw(const Codec* c, void* work, const unsigned char* src, size_t n, unsigned char* dst, size_t capacity){
+    LzwEncoder* e = (LzwEncoder*) work;
+    lzw_code_t* codes = (lzw_code_t*) dst;
+    lzwEncoderInit(e);
+    size_t count = lzwEncode(e, src, n, codes);
+    count += lzwEncodeEnd(e, codes + count);
+    return count * sizeof(lzw_code_t);
+}
+
+static int lzwDecodeRaw(const Codec* c, void* work, const unsigned char* src, size_t size, unsigned char* dst, size_t n){
+    LzwDecoder* d = (LzwDecoder*) work;
+    size_t count = size / sizeof(lzw_code_t), used;
+    lzwDecoderInit(d);
+    size_t out = lzwDecode(d, (const lzw_code_t*) src, count, &used, dst, n);
+    return d->error || used != count || out != n ? -1 : 0;
+}
+
+static const LzwKernelOps* lzwPick(const Codec* c, size_t n){
+    return c->bits ? lzwKernel(c->bits) : lzwKernelFor(n);
+}
+
+static size_t lzwKernelEncode(const Codec* c, void* work, const unsigned char* src, size_t n, unsigned char* dst, size_t capacity){
+    return lzwPick(c, n)->encode(work, src, n, dst, capacity);
+}
+
+static int lzwKernelDecode(const Codec* c, void* work, const unsigned char* src, size_t size, unsigned char* dst, size_t n){
+    return lzwPick(c, n)->decode(work, src, size, dst, n);
+}
+
+static const Codec codecs[] = {
+    { "huff",     0,  huffEncode,       huffDecode },
+    { "huff8",    8,  huffKernelEncode, huffKernelDecode },
+    { "huff16",   16, huffKernelEncode, huffKernelDecode },
+    { "lzw",      0,  lzwEncodeRaw,     lzwDecodeRaw },
+    { "lzw12",    12, lzwKernelEncode,  lzwKernelDecode },
+    { "lzw16",    16, lzwKernelEncode,  lzwKernelDecode },
+    { "lzw20",    20, lzwKernelEncode,  lzwKernelDecode },
+    { "lzw_auto", 0,  lzwKernelEncode,  lzwKernelDecode },
+};
+#define CODECS ((int) (sizeof(codecs) / sizeof(codecs[0])))
+
+static double now(){
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+typedef struct Encoded {
+    unsigned char* data;
+    size_t* sizes;    // encoded size of each block
+    size_t capacity;  // room for each block
+    size_t total;
+} Encoded;
+
+static void encodeAll(const Codec* c, void* work, const unsigned char* src, size_t n, size_t block, Encoded* e){
+    size_t pos, b = 0;
+    e->total = 0;
+    for( pos=0; pos<n; pos+=block, b++ ){
+        size_t len = n - pos < block ? n - pos : block;
+        e->sizes[b] = c->encode(c, work, src + pos, len, e->data + b * e->capacity, e->capacity);
+        e->total += e->sizes[b];
+    }
+}
+
+static int decodeAll(const Codec* c, void* work, const Encoded* e, unsigned char* dst, size_t n, size_t block){
+    size_t pos, b = 0;
+    int error = 0;
+    for( pos=0; pos<n; pos+=block, b++ ){
+        size_t len = n - pos < block ? n - pos : block;
+        error |= c->decode(c, work, e->data + b * e->capacity, e->sizes[b], dst + pos, len) != 0;
+    }
+    return error;
+}
+
+int main(int argc, char *argv[]){
+    size_t block = 1<<16;
+    double scale = 1;
+
+    int opt;
+    while( (opt = getopt(argc, argv, "b:s:")) != -1 ){
+        switch (opt) {
+            case 'b': block = atol(optarg); break;
+            case 's': scale = atof(optarg); break;
+            default:
+                fprintf(stderr, "Usage: %s [-b block] [-s scale]\n", argv[0]);
+                return -1;
+        }
+    }
+    // 16 bit kernels need whole symbols in every block
+    block = (block + 1) & ~(size_t) 1;
+    if (block < 2) block = 2;
+
+    // one workspace and one slot per block that fit every codec
+    size_t workspace = sizeof(LzwEncoder) > sizeof(LzwDecoder) ? sizeof(LzwEncoder) : sizeof(LzwDecoder);
+    int bits;
+    if (sizeof(HuffTables) > workspace) workspace = sizeof(HuffTables);
+    for( bits=8; bits<=16; bits+=8 )
+        if (huffKernel(bits)->workspace > workspace) workspace = huffKernel(bits)->workspace;
+    for( bits=12; bits<=20; bits+=4 )
+        if (lzwKernel(bits)->workspace > workspace) workspace = lzwKernel(bits)->workspace;
+    void* work = malloc(workspace);
+
+    Encoded e;
+    e.capacity = huffKernelBound(huffKernel(16), block / 2) + lzwKernelBound(lzwKernel(20), block) + 2 * block;
+
+    printf("{\n  \"block\": %zu,\n  \"results\": [", block);
+    double huffTime[2] = { 0, 0 }, kernelTime[2] = { 0, 0 };
+    int c, k, first = 1, failed = 0;
+    for( c=0; c<CORPUS; c++ ){
+        size_t n;
+        unsigned char* src = loadCorpus(&corpus[c], scale, &n);
+        unsigned char* back = (unsigned char*) malloc(n + 1);
+        size_t blocks = (n + block - 1) / block;
+        e.data = (unsigned char*) malloc((blocks + 1) * e.capacity);
+        e.sizes = (size_t*) malloc((blocks + 1) * sizeof(size_t));
+
+        for( k=0; k<CODECS; k++ ){
+            const Codec* codec = &codecs[k];
+            if (codec->bits == 16 && codec->encode == huffKernelEncode && n % 2) continue;
+
+            int runs = 0;
+            double start = now(), encodeTime, decodeTime;
+            do { encodeAll(codec, work, src, n, block, &e); runs++; }
+            while ((encodeTime = now() - start) < MIN_SECONDS);
+            encodeTime /= runs;
+
+            runs = 0;
+            int error = 0;
+            start = now();
+            do { error |= decodeAll(codec, work, &e, back, n, block); runs++; }
+            while ((decodeTime = now() - start) < MIN_SECONDS);
+            decodeTime /= runs;
+
+            if (!strcmp(codec->name, "huff"))  { huffTime[0] += encodeTime; huffTime[1] += decodeTime; }
+            if (!strcmp(codec->name, "huff8")) { kernelTime[0] += encodeTime; kernelTime[1] += decodeTime; }
+
+            int ok = !error && !memcmp(src, back, n);
+            failed += !ok;
+            printf("%s\n    {\"codec\": \"%s\", \"file\": \"%s\", \"size\": %zu, \"compressed\": %zu, "
+                   "\"ratio\": %.4f, \"compress_mbps\": %.3f, \"decompress_mbps\": %.3f, \"roundtrip\": %s}",
+                first ? "" : ",", codec->name, corpus[c].name, n, e.total,
+                n ? e.total / (double) n : 0, n / (double) MiB / encodeTime, n / (double) MiB / decodeTime,
+                ok ? "true" : "false");
+            first = 0;
+        }
+
+        free(e.data);
+        free(e.sizes);
+        free(back);
+        free(src);
+    }
+    printf("\n  ],\n  \"huff8_speedup\": {\"compress\": %.3f, \"decompress\": %.3f},\n  \"failed\": %d\n}\n",
+        huffTime[0] / kernelTime[0], huffTime[1] / kernelTime[1], failed);
+
+    free(work);
+    return failed ? 1 : 0;
+}
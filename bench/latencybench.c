@@ -0,0 +1,166 @@
+/*****************************************************
+ * latencybench -- program to measure per call       *
+ *                 latency of huffbuf on small       *
+ *                 messages cut from the corpus      *
+ *                                                   *
+ * Usage:                                            *
+ *      latencybench [-n calls]                      *
+ *          - calls: calls per message size, 5000    *
+ *            by default                             *
+ *                                                   *
+ * Messages of 256 B to 64 KiB are taken from every  *
+ * corpus file at moving offsets, each call is timed *
+ * on its own. Report (JSON) with p50 and p99 in     *
+ * microseconds is written to standard output. Heap  *
+ * calls made while timing are counted (the bench    *
+ * defines malloc, so calls from inside libc count   *
+ * too), huffbuf should make none. Last file uses    *
+ * all 256 byte values in every message of 1 KiB or  *
+ * more.                                             *
+ *****************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "bench/corpus.h"
+#include "huff/huffbuf.h"
+
+static const size_t sizes[] = { 256, 1024, 4096, 16384, 65536 };
+#define SIZES ((int) (sizeof(sizes) / sizeof(sizes[0])))
+
+/*
+    Replaces the allocator for the whole program, so calls libc makes on its
+    own (qsort does past 1 KiB) are counted as well. glibc exports the real
+    allocator under __libc_ names.
+*/
+static int counting;
+static long allocations;
+
+void* __libc_malloc(size_t size);
+void* __libc_calloc(size_t count, size_t size);
+void* __libc_realloc(void* p, size_t size);
+
+void* malloc(size_t size){
+    allocations += counting;
+    return __libc_malloc(size);
+}
+
+void* calloc(size_t count, size_t size){
+    allocations += counting;
+    return __libc_calloc(count, size);
+}
+
+void* realloc(void* p, size_t size){
+    allocations += counting;
+    return __libc_realloc(p, size);
+}
+
+static double now(){
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static int ascending(const void* a, const void* b){
+    double x = *(const double*) a, y = *(const double*) b;
+    return x < y ? -1 : x > y;
+}
+
+/*
+    Period of 1 KiB, every byte value once and then skewed bytes, so huffbuf
+    has to build codes for all 256 symbols.
+*/
+#define ALL_SYMBOLS (4 * sizes[SIZES-1])
+
+static unsigned char* allSymbols(size_t n){
+    unsigned char* src = (unsigned char*) malloc(n);
+    unsigned int x = 1;
+    size_t i;
+    for( i=0; i<n; i++ ){
+        x = x * 1103515245 + 12345;
+        src[i] = i % 1024 < 256 ? i % 1024 : (x >> 24) & (x >> 16);
+    }
+    return src;
+}
+
+// sorts times and returns the given percentile in microseconds
+static double percentile(double* times, int n, int p){
+    qsort(times, n, sizeof(double), ascending);
+    return times[(long) (n - 1) * p / 100] * 1e6;
+}
+
+int main(int argc, char *argv[]){
+    int calls = 5000;
+
+    int opt;
+    while( (opt = getopt(argc, argv, "n:")) != -1 ){
+        switch (opt) {
+            case 'n': calls = atoi(optarg); break;
+            default:
+                fprintf(stderr, "Usage: %s [-n calls]\n", argv[0]);
+                return -1;
+        }
+    }
+    if (calls < 1) calls = 1;
+
+    HuffWorkspace* w = (HuffWorkspace*) malloc(sizeof(HuffWorkspace));
+    double* compressTimes = (double*) malloc(calls * sizeof(double));
+    double* decompressTimes = (double*) malloc(calls * sizeof(double));
+    unsigned char* packed = (unsigned char*) malloc(huffCompressBound(sizes[SIZES-1]));
+    unsigned char* back = (unsigned char*) malloc(sizes[SIZES-1]);
+
+    printf("{\n  \"calls\": %d,\n  \"results\": [", calls);
+    int c, s, i, first = 1, failed = 0;
+    for( c=0; c<=CORPUS; c++ ){
+        size_t n = ALL_SYMBOLS;
+        unsigned char* src = c < CORPUS ? loadCorpus(&corpus[c], 1, &n) : allSymbols(n);
+        const char* name = c < CORPUS ? corpus[c].name : "all-256";
+
+        for( s=0; s<SIZES; s++ ){
+            size_t size = sizes[s];
+            if (size > n) continue;
+
+            unsigned long long in = 0, out = 0;
+            int ok = 1;
+            counting = 1;
+            for( i=0; i<calls; i++ ){
+                const unsigned char* message = src + (i * (size / 2 + 1)) % (n - size + 1);
+
+                double start = now();
+                size_t m = huffCompress(w, message, size, packed, huffCompressBound(size));
+                compressTimes[i] = now() - start;
+
+                start = now();
+                long long k = huffDecompress(w, packed, m, back, size);
+                decompressTimes[i] = now() - start;
+
+                ok &= k == (long long) size && !memcmp(message, back, size);
+                in += size;
+                out += m;
+            }
+            counting = 0;
+            failed += !ok;
+
+            printf("%s\n    {\"file\": \"%s\", \"size\": %zu, \"ratio\": %.4f, "
+                   "\"compress_p50_us\": %.3f, \"compress_p99_us\": %.3f, "
+                   "\"decompress_p50_us\": %.3f, \"decompress_p99_us\": %.3f, \"roundtrip\": %s}",
+                first ? "" : ",", name, size, out / (double) in,
+                percentile(compressTimes, calls, 50), percentile(compressTimes, calls, 99),
+                percentile(decompressTimes, calls, 50), percentile(decompressTimes, calls, 99),
+                ok ? "true" : "false");
+            first = 0;
+        }
+        free(src);
+    }
+    printf("\n  ],\n  \"allocations\": %ld,\n  \"failed\": %d\n}\n", allocations, failed);
+
+    free(back);
+    free(packed);
+    free(decompressTimes);
+    free(compressTimes);
+    free(w);
+    return failed || allocations ? 1 : 0;
+}
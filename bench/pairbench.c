@@ -0,0 +1,223 @@
+/*****************************************************
+ * pairbench -- program to measure Huffman coding of *
+ *              byte pairs against single bytes,     *
+ *              by average code length               *
+ *                                                   *
+ * Usage:                                            *
+ *      pairbench [-b block] [-s scale]              *
+ *          - block: block size in bytes             *
+ *          - scale: corpus size multiplier          *
+ *                                                   *
+ * Every corpus file, and geometric sources that     *
+ * span code lengths of 1 to 8 bits, is coded in     *
+ * memory with huff/huffman.c one byte at a time and *
+ * with the pair tables, tables built per block.     *
+ * Report (JSON) with the speedup of each input and  *
+ * per code length bucket is written to standard     *
+ * output.                                           *
+ *****************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "bench/corpus.h"
+#include "huff/huffman.h"
+
+#define R 256
+#define MIN_SECONDS 0.05
+#define ROUNDS 5     // single and pair runs alternate, best of each is kept
+
+// ratio of neighbouring byte probabilities in the geometric sources
+static const double ratios[] = { 0.05, 0.3, 0.6, 0.8, 0.9, 0.95, 0.98 };
+#define RATIOS ((int) (sizeof(ratios) / sizeof(ratios[0])))
+#define GEOMETRIC_SIZE MiB
+
+// buckets of average code length, in bits
+#define BUCKETS 4
+static const char* buckets[BUCKETS] = { "0-2", "2-4", "4-6", "6-8" };
+
+typedef struct Tables {
+    unsigned char lengths[R];
+    HuffEncoder encoder;
+    HuffDecoder decoder;
+    HuffPairEncoder pairEncoder;
+    HuffPairDecoder pairDecoder;
+} Tables;
+
+static double now(){
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static unsigned int xorshift(unsigned int* state){
+    unsigned int x = *state;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    return *state = x;
+}
+
+static unsigned char* geometric(double ratio, size_t n){
+    unsigned char* data = (unsigned char*) malloc(n);
+    double cdf[R], sum = 0, p = 1;
+    unsigned int state = 2463534242u;
+    size_t i;
+    int s;
+
+    for( s=0; s<R; s++, p*=ratio ) cdf[s] = sum += p;
+    for( i=0; i<n; i++ ){
+        double u = xorshift(&state) / 4294967296.0 * sum;
+        for( s=0; s<R-1 && cdf[s] <= u; s++ );
+        data[i] = s;
+    }
+    return data;
+}
+
+// room for a coded block, codes never take over 2 bytes a byte
+static size_t slot(size_t block){
+    return 2 * block + R / 2;
+}
+
+/*
+    Codes every block with its own tables, returns total size in bytes.
+    Bits of the codes (no lengths) are added to bits.
+*/
+static size_t encodeAll(Tables* t, int pairs, const unsigned char* src, size_t n, size_t block,
+                        unsigned char* dst, size_t* sizes, unsigned long long* bits){
+    size_t pos, total = 0, b = 0;
+    for( pos=0; pos<n; pos+=block, b++ ){
+        size_t len = n - pos < block ? n - pos : block;
+        huff_freq_t freqs[R];
+        BitWriter w;
+        int s;
+
+        huffHistogram(src + pos, len, freqs);
+        huffLengths(freqs, R, HUFF_MAX_BITS, t->lengths);
+        huffBuildEncoder(&t->encoder, t->lengths, R);
+        int paired = pairs && huffBuildPairEncoder(&t->pairEncoder, &t->encoder, len);
+
+        initBitWriter(&w, dst + b * slot(block), slot(block));
+        huffWriteLengths(&w, t->lengths, R);
+        huffPutBytes(&w, &t->encoder, paired ? &t->pairEncoder : NULL, src + pos, len);
+        sizes[b] = flushBits(&w);
+        total += sizes[b];
+        if (bits) for( s=0; s<R; s++ ) *bits += freqs[s] * t->lengths[s];
+    }
+    return total;
+}
+
+static int decodeAll(Tables* t, int pairs, const unsigned char* src, const size_t* sizes,
+                     unsigned char* dst, size_t n, size_t block){
+    size_t pos, b = 0;
+    int error = 0;
+    for( pos=0; pos<n; pos+=block, b++ ){
+        size_t len = n - pos < block ? n - pos : block;
+        BitReader r;
+
+        initBitReader(&r, src + b * slot(block), sizes[b]);
+        if (huffReadLengths(&r, t->lengths, R) || huffBuildDecoder(&t->decoder, t->lengths, R)) return -1;
+        int paired = pairs && huffBuildPairDecoder(&t->pairDecoder, &t->decoder, len);
+        error |= huffGetBytes(&r, &t->decoder, paired ? &t->pairDecoder : NULL, dst + pos, len) || overrun(&r);
+    }
+    return error;
+}
+
+int main(int argc, char *argv[]){
+    size_t block = 1<<16;
+    double scale = 1;
+
+    int opt;
+    while( (opt = getopt(argc, argv, "b:s:")) != -1 ){
+        switch (opt) {
+            case 'b': block = atol(optarg); break;
+            case 's': scale = atof(optarg); break;
+            default:
+                fprintf(stderr, "Usage: %s [-b block] [-s scale]\n", argv[0]);
+                return -1;
+        }
+    }
+    if (block < 1) block = 1;
+
+    Tables* t = (Tables*) malloc(sizeof(Tables));
+    double time[BUCKETS][2][2];  // bucket, single or pairs, encode or decode
+    memset(time, 0, sizeof(time));
+
+    printf("{\n  \"block\": %zu,\n  \"results\": [", block);
+    int input, first = 1, failed = 0;
+    for( input=0; input<CORPUS+RATIOS; input++ ){
+        char name[32];
+        size_t n;
+        unsigned char* src;
+        if (input < CORPUS) {
+            src = loadCorpus(&corpus[input], scale, &n);
+            snprintf(name, sizeof(name), "%s", corpus[input].name);
+        } else {
+            n = GEOMETRIC_SIZE * scale;
+            src = geometric(ratios[input - CORPUS], n);
+            snprintf(name, sizeof(name), "geometric_%.2f", ratios[input - CORPUS]);
+        }
+
+        size_t blocks = (n + block - 1) / block;
+        unsigned char* packed = (unsigned char*) malloc((blocks + 1) * slot(block));
+        unsigned char* back = (unsigned char*) malloc(n + 1);
+        size_t* sizes = (size_t*) malloc((blocks + 1) * sizeof(size_t));
+        double seconds[2][2] = { { 1e9, 1e9 }, { 1e9, 1e9 } };
+        unsigned long long bits = 0;
+        int pairs, round, ok = 1;
+
+        encodeAll(t, 0, src, n, block, packed, sizes, &bits);
+        for( round=0; round<ROUNDS; round++ ) for( pairs=0; pairs<2; pairs++ ){
+            int runs = 0;
+            double elapsed, start = now();
+            do { encodeAll(t, pairs, src, n, block, packed, sizes, NULL); runs++; }
+            while ((elapsed = now() - start) < MIN_SECONDS);
+            if (elapsed / runs < seconds[pairs][0]) seconds[pairs][0] = elapsed / runs;
+
+            runs = 0;
+            int error = 0;
+            start = now();
+            do { error |= decodeAll(t, pairs, packed, sizes, back, n, block); runs++; }
+            while ((elapsed = now() - start) < MIN_SECONDS);
+            if (elapsed / runs < seconds[pairs][1]) seconds[pairs][1] = elapsed / runs;
+            ok &= !error && !memcmp(src, back, n);
+        }
+        failed += !ok;
+
+        double length = n ? bits / (double) n : 0;
+        int bucket = length < 2 ? 0 : length < 4 ? 1 : length < 6 ? 2 : 3;
+        int k;
+        for( pairs=0; pairs<2; pairs++ ) for( k=0; k<2; k++ ) time[bucket][pairs][k] += seconds[pairs][k];
+
+        printf("%s\n    {\"file\": \"%s\", \"size\": %zu, \"avg_code_length\": %.3f, "
+               "\"compress_mbps\": %.3f, \"pair_compress_mbps\": %.3f, "
+               "\"decompress_mbps\": %.3f, \"pair_decompress_mbps\": %.3f, "
+               "\"compress_speedup\": %.3f, \"decompress_speedup\": %.3f, \"roundtrip\": %s}",
+            first ? "" : ",", name, n, length,
+            n / (double) MiB / seconds[0][0], n / (double) MiB / seconds[1][0],
+            n / (double) MiB / seconds[0][1], n / (double) MiB / seconds[1][1],
+            seconds[0][0] / seconds[1][0], seconds[0][1] / seconds[1][1], ok ? "true" : "false");
+        first = 0;
+
+        free(sizes);
+        free(back);
+        free(packed);
+        free(src);
+    }
+
+    printf("\n  ],\n  \"speedup_by_code_length\": [");
+    int b;
+    for( b=0, first=1; b<BUCKETS; b++ ){
+        if (time[b][1][0] == 0) continue;
+        printf("%s\n    {\"bits\": \"%s\", \"compress\": %.3f, \"decompress\": %.3f}", first ? "" : ",",
+            buckets[b], time[b][0][0] / time[b][1][0], time[b][0][1] / time[b][1][1]);
+        first = 0;
+    }
+    printf("\n  ],\n  \"failed\": %d\n}\n", failed);
+
+    free(t);
+    return failed ? 1 : 0;
+}
@@ -0,0 +1,361 @@
+/***************************************************
+ * block -- independent compression of in-memory   *
+ *          blocks with one of the repo's codecs   *
+ ***************************************************/
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "ans/rans.h"
+#include "block/block.h"
+#include "bwt/bwt.h"
+#include "huff/huffkernels.h"
+#include "huff/huffman.h"
+#include "lzh/lzh.h"
+#include "lzw/lzw.h"
+
+#define R 256
+
+// blockChoose samples this many evenly spaced windows
+#define SAMPLE_WINDOWS 8
+#define SAMPLE_WINDOW 1024
+#define PROBE_BITS 12
+
+static const char* names[BLOCK_METHODS + 1] = { "stored", "huff", "lzh", "rans", "bwt", "huff16", "auto" };
+
+int blockMethod(const char* name){
+    int m;
+    for( m=0; m<=BLOCK_AUTO; m++ ) if (!strcmp(name, names[m])) return m;
+    return -1;
+}
+
+const char* blockMethodName(int method){
+    return method >= 0 && method <= BLOCK_AUTO ? names[method] : "unknown";
+}
+
+static void put32(unsigned char* p, unsigned int x){
+    p[0] = x; p[1] = x >> 8; p[2] = x >> 16; p[3] = x >> 24;
+}
+
+static unsigned int get32(const unsigned char* p){
+    return p[0] | p[1] << 8 | p[2] << 16 | (unsigned int) p[3] << 24;
+}
+
+// stored
+
+static size_t storedEncode(const unsigned char* src, size_t n, unsigned char* dst){
+    dst[0] = BLOCK_STORED;
+    memcpy(dst + 1, src, n);
+    return n + 1;
+}
+
+// huff: 256 code lengths and the codes, in one bit stream
+
+static size_t huffEncode(const unsigned char* src, size_t n, const huff_freq_t* freqs, unsigned char* dst, size_t capacity){
+    HuffPairEncoder* pairs = NULL;
+    unsigned char lengths[R];
+    HuffEncoder e;
+    BitWriter w;
+
+    huffLengths(freqs, R, HUFF_MAX_BITS, lengths);
+    huffBuildEncoder(&e, lengths, R);
+    if (huffPairsPay(&e, n)){
+        pairs = (HuffPairEncoder*) malloc(sizeof(HuffPairEncoder));
+        huffBuildPairEncoder(pairs, &e, n);
+    }
+
+    initBitWriter(&w, dst, capacity);
+    huffWriteLengths(&w, lengths, R);
+    huffPutBytes(&w, &e, pairs, src, n);
+    size_t size = flushBits(&w);
+    free(pairs);
+    return w.overflow ? 0 : size;
+}
+
+static int huffDecode(const unsigned char* src, size_t size, unsigned char* dst, size_t n){
+    unsigned char lengths[R];
+    HuffDecoder d;
+    HuffPairDecoder pairs;
+    BitReader r;
+
+    initBitReader(&r, src, size);
+    if (huffReadLengths(&r, lengths, R) || huffBuildDecoder(&d, lengths, R)) return -1;
+    int paired = huffBuildPairDecoder(&pairs, &d, n);
+    if (huffGetBytes(&r, &d, paired ? &pairs : NULL, dst, n)) return -1;
+    return overrun(&r) ? -1 : 0;
+}
+
+// huff16: 16 bit little endian symbols through the huffKernel(16) block,
+// then an odd last byte as it is
+
+static size_t huff16Encode(const unsigned char* src, size_t n, unsigned char* dst, size_t capacity){
+    const HuffKernelOps* k = huffKernel(16);
+    size_t m = n / 2, i;
+    if (capacity < n % 2) return 0;
+
+    unsigned short* symbols = (unsigned short*) malloc((m + 1) * sizeof(unsigned short));
+    void* work = malloc(k->workspace);
+    for( i=0; i<m; i++ ) symbols[i] = src[2*i] | src[2*i+1] << 8;
+    size_t size = k->encode(work, symbols, m, dst, capacity - n % 2);
+    if (size && n % 2) dst[size++] = src[n-1];
+
+    free(work);
+    free(symbols);
+    return size;
+}
+
+static int huff16Decode(const unsigned char* src, size_t size, unsigned char* dst, size_t n){
+    const HuffKernelOps* k = huffKernel(16);
+    size_t m = n / 2, i;
+    if (size < n % 2) return -1;
+
+    unsigned short* symbols = (unsigned short*) malloc((m + 1) * sizeof(unsigned short));
+    void* work = malloc(k->workspace);
+    int error = k->decode(work, src, size - n % 2, symbols, m);
+    for( i=0; i<m && !error; i++ ){
+        dst[2*i] = symbols[i];
+        dst[2*i+1] = symbols[i] >> 8;
+    }
+    if (!error && n % 2) dst[n-1] = src[size-1];
+
+    free(work);
+    free(symbols);
+    return error;
+}
+
+// lzh: u32 number of codes, then same bit stream as an lzhkoder block
+
+static size_t lzhEncode(const unsigned char* src, size_t n, unsigned char* dst, size_t capacity){
+    if (capacity < 4) return 0;
+    LzwEncoder* lzw = (LzwEncoder*) malloc(sizeof(LzwEncoder));
+    lzw_code_t* codes = (lzw_code_t*) malloc((n + 1) * sizeof(lzw_code_t));
+    huff_freq_t freqs[LZH_SYMBOLS] = { 0 };
+    unsigned char lengths[LZH_SYMBOLS];
+    HuffEncoder e;
+    BitWriter w;
+    size_t i;
+
+    lzwEncoderInit(lzw);
+    size_t count = lzwEncode(lzw, src, n, codes);
+    count += lzwEncodeEnd(lzw, codes + count);
+
+    for( i=0; i<count; i++ ) freqs[lzhSymbol(codes[i])]++;
+    huffLengths(freqs, LZH_SYMBOLS, HUFF_MAX_BITS, lengths);
+    huffBuildEncoder(&e, lengths, LZH_SYMBOLS);
+
+    put32(dst, count);
+    initBitWriter(&w, dst + 4, capacity - 4);
+    huffWriteLengths(&w, lengths, LZH_SYMBOLS);
+    for( i=0; i<count && !w.overflow; i++ ) lzhPut(&w, &e, codes[i]);
+    size_t size = flushBits(&w) + 4;
+
+    free(codes);
+    free(lzw);
+    return w.overflow ? 0 : size;
+}
+
+static int lzhDecode(const unsigned char* src, size_t size, unsigned char* dst, size_t n){
+    if (size < 4) return -1;
+    size_t count = get32(src);
+    if (count > n) return -1;
+
+    lzw_code_t* codes = (lzw_code_t*) malloc((count + 1) * sizeof(lzw_code_t));
+    unsigned char lengths[LZH_SYMBOLS];
+    HuffDecoder d;
+    BitReader r;
+    size_t i;
+    int error = 0;
+
+    initBitReader(&r, src + 4, size - 4);
+    if (huffReadLengths(&r, lengths, LZH_SYMBOLS) || huffBuildDecoder(&d, lengths, LZH_SYMBOLS)) error = 1;
+    for( i=0; i<count && !error; i++ ){
+        int code = lzhGet(&r, &d);
+        if (code < 0 || code >= LZW_DICT_SIZE) error = 1;
+        else codes[i] = code;
+    }
+    if (overrun(&r)) error = 1;
+
+    if (!error){
+        LzwDecoder* lzw = (LzwDecoder*) malloc(sizeof(LzwDecoder));
+        size_t used;
+        lzwDecoderInit(lzw);
+        size_t written = lzwDecode(lzw, codes, count, &used, dst, n);
+        error = lzw->error || used != count || written != n;
+        free(lzw);
+    }
+
+    free(codes);
+    return error ? -1 : 0;
+}
+
+// coders blockChoose may pick, fastest first so it wins ties; order-0 ones
+// are estimated from the histogram, bwt is the one it trial-encodes
+static const int candidates[] = { BLOCK_HUFF, BLOCK_RANS, BLOCK_BWT };
+#define CANDIDATES ((int) (sizeof(candidates) / sizeof(candidates[0])))
+
+// smallest bwt payload: primary index and 4 bit code lengths
+#define BWT_HEADER (4 + (BWT_SYMBOLS * 4 + 7) / 8)
+
+/*
+    log2(x) in 1/64 bits, x at least 1. Squaring the mantissa doubles its
+    log, so every squaring that carries past 2 is one more fraction bit.
+*/
+static unsigned int log2Fixed(unsigned int x){
+    unsigned int k = 0, frac = 0, i;
+    while (x >> (k + 1)) k++;
+
+    unsigned long long m = k > 16 ? x >> (k - 16) : (unsigned long long) x << (16 - k);
+    for( i=0; i<6; i++ ){
+        m = m * m >> 16;
+        frac <<= 1;
+        if (m >= 1u<<17) { m >>= 1; frac |= 1; }
+    }
+    return k << 6 | frac;
+}
+
+/*
+    Payload bits of rans: the cost of every symbol under the normalized
+    histogram, the frequency table and the two states.
+*/
+static unsigned long long ransBits(const huff_freq_t* freqs){
+    unsigned int norm[R];
+    unsigned long long cost = 0;
+    int i;
+
+    ransNormalize(freqs, R, norm);
+    for( i=0; i<R; i++ ){
+        if (!freqs[i]) { cost += 64; continue; }
+        cost += freqs[i] * (RANS_SCALE_BITS * 64 - log2Fixed(norm[i])) + 64 * (1 + RANS_SCALE_BITS);
+    }
+    return cost / 64 + 64;
+}
+
+/*
+    Huffman cost of the sample's histogram tells what huff would save.
+    Share of 4 byte strings seen before in the sample tells whether LZW
+    or BWT will find repeats; windows are far apart, so only repeats
+    across the whole block are counted between them. A sample neither can
+    shrink is stored. Otherwise huff and rans are costed from the same
+    histogram, and bwt encodes the sample only if it has repeats and the
+    better of the two still leaves more than its header: context is
+    measured, not guessed, but at most once per block.
+*/
+int blockChoose(const unsigned char* src, size_t n){
+    unsigned char sample[SAMPLE_WINDOWS * SAMPLE_WINDOW];
+    unsigned char trial[SAMPLE_WINDOWS * SAMPLE_WINDOW + 1];
+    unsigned short seen[1<<PROBE_BITS];
+    huff_freq_t freqs[R];
+    unsigned char lengths[R];
+    size_t i, size = 0, matches = 0;
+    unsigned long long bits = 0;
+
+    if (n <= sizeof(sample)){
+        memcpy(sample, src, n);
+        size = n;
+    } else {
+        for( i=0; i<SAMPLE_WINDOWS; i++ ){
+            memcpy(sample + size, src + (n - SAMPLE_WINDOW) / (SAMPLE_WINDOWS - 1) * i, SAMPLE_WINDOW);
+            size += SAMPLE_WINDOW;
+        }
+    }
+    if (size < 4) return BLOCK_STORED;
+
+    huffHistogram(sample, size, freqs);
+    huffLengths(freqs, R, HUFF_MAX_BITS, lengths);
+    for( i=0; i<R; i++ ) bits += (unsigned long long) freqs[i] * lengths[i];
+
+    memset(seen, 0, sizeof(seen));
+    for( i=0; i+4<=size; i++ ){
+        unsigned int x;
+        memcpy(&x, sample + i, 4);
+        unsigned int h = (x * 2654435761u) >> (32 - PROBE_BITS);
+        if (seen[h] && !memcmp(sample + seen[h] - 1, sample + i, 4)) matches++;
+        seen[h] = i + 1;
+    }
+
+    // huff needs an eighth saved, bwt a few repeats
+    if (bits > 7 * size && matches * 16 < size) return BLOCK_STORED;
+
+    // payload sizes, stored wins ties
+    int best = BLOCK_STORED;
+    size_t smallest = size;
+    size_t huffSize = (bits + R * 4 + 7) / 8;
+    size_t ransSize = (ransBits(freqs) + 7) / 8;
+    if (huffSize < smallest) { smallest = huffSize; best = BLOCK_HUFF; }
+    if (ransSize < smallest) { smallest = ransSize; best = BLOCK_RANS; }
+
+    if (matches * 16 >= size && smallest > BWT_HEADER){
+        size_t trialSize = blockEncode(BLOCK_BWT, sample, size, trial) - 1;
+        if (trialSize < smallest) best = BLOCK_BWT;
+    }
+    return best;
+}
+
+/*
+    Every level of the SA-IS recursion sorts at most half the suffixes of
+    the level above and keeps a type byte and a bucket for each, while the
+    levels above keep theirs: n/2 + n/4 + ... stays under n of each.
+*/
+static size_t saisRecursion(size_t n){
+    return n * (1 + sizeof(int));
+}
+
+size_t blockMemory(int method, size_t n){
+    // auto may pick any candidate, and tries bwt on the smaller sample
+    if (method == BLOCK_AUTO){
+        size_t most = 0, m;
+        int c;
+        for( c=0; c<CANDIDATES; c++ ) if ((m = blockMemory(candidates[c], n)) > most) most = m;
+        return most;
+    }
+    switch (method) {
+        // pair table of huff if the block is long enough for one, kernel and
+        // symbols of huff16, codes of the block, and for bwt the suffix array
+        // next to the last column, zero runs and the type of every suffix
+        case BLOCK_HUFF: return n < 1<<HUFF_PAIR_BITS ? 0 : sizeof(HuffPairEncoder);
+        case BLOCK_HUFF16: return huffKernel(16)->workspace + (n / 2 + 1) * sizeof(unsigned short);
+        case BLOCK_LZH:  return sizeof(LzwEncoder) + (n + 1) * sizeof(lzw_code_t);
+        case BLOCK_BWT:  return (n + 1) * sizeof(int) + n * (1 + sizeof(unsigned short) + 1) + n / 2
+                                + (R + 1) * sizeof(int) + saisRecursion(n);
+    }
+    return 0;
+}
+
+size_t blockEncode(int method, const unsigned char* src, size_t n, unsigned char* dst){
+    huff_freq_t freqs[R];
+    size_t size = 0;
+
+    if (method == BLOCK_AUTO) method = blockChoose(src, n);
+    if (method == BLOCK_STORED) return storedEncode(src, n, dst);
+
+    // byte entropy coders share one histogram pass
+    if (method == BLOCK_HUFF || method == BLOCK_RANS) huffHistogram(src, n, freqs);
+
+    // payload has to be smaller than the stored one
+    switch (method) {
+        case BLOCK_HUFF: size = huffEncode(src, n, freqs, dst + 1, n); break;
+        case BLOCK_LZH:  size = lzhEncode(src, n, dst + 1, n);         break;
+        case BLOCK_RANS: size = ransEncode(src, n, freqs, dst + 1, n); break;
+        case BLOCK_BWT:  size = bwtEncode(src, n, dst + 1, n);         break;
+        case BLOCK_HUFF16: size = huff16Encode(src, n, dst + 1, n);    break;
+    }
+    if (!size || size >= n) return storedEncode(src, n, dst);
+    dst[0] = method;
+    return size + 1;
+}
+
+int blockDecode(const unsigned char* src, size_t size, unsigned char* dst, size_t n){
+    if (size < 1) return -1;
+    switch (src[0]) {
+        case BLOCK_STORED:
+            if (size - 1 != n) return -1;
+            memcpy(dst, src + 1, n);
+            return 0;
+        case BLOCK_HUFF: return huffDecode(src + 1, size - 1, dst, n);
+        case BLOCK_LZH:  return lzhDecode(src + 1, size - 1, dst, n);
+        case BLOCK_RANS: return ransDecode(src + 1, size - 1, dst, n);
+        case BLOCK_BWT:  return bwtDecode(src + 1, size - 1, dst, n);
+        case BLOCK_HUFF16: return huff16Decode(src + 1, size - 1, dst, n);
+    }
+    return -1;
+}
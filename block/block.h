@@ -0,0 +1,63 @@
+/***************************************************
+ * block -- independent compression of in-memory   *
+ *          blocks with one of the repo's codecs   *
+ *                                                 *
+ * Encoded block: u8 method, payload.              *
+ * Uncompressed size is not stored, containers     *
+ * keep it in their index.                         *
+ ***************************************************/
+
+#ifndef BLOCK_H
+#define BLOCK_H
+
+#include <stddef.h>
+
+#define BLOCK_STORED 0
+#define BLOCK_HUFF   1
+#define BLOCK_LZH    2
+#define BLOCK_RANS   3
+#define BLOCK_BWT    4
+#define BLOCK_HUFF16 5
+#define BLOCK_METHODS 6
+
+// not a stored method, blockEncode picks one of the above per block
+#define BLOCK_AUTO   BLOCK_METHODS
+
+/*
+    Encoded block is never bigger than this, incompressible
+    data falls back to a stored block.
+*/
+static inline size_t blockBound(size_t n){
+    return n + 1;
+}
+
+/*
+    Returns method with the given name, -1 if there is none.
+*/
+int blockMethod(const char* name);
+const char* blockMethodName(int method);
+
+/*
+    Guesses from a sample of the block whether it is worth coding, and if
+    so picks the method that codes the sample smallest: huff and rans by
+    their cost on its histogram, bwt by encoding it.
+*/
+int blockChoose(const unsigned char* src, size_t n);
+
+/*
+    Memory blockEncode allocates for a block of n bytes with the given
+    method, on top of src and dst.
+*/
+size_t blockMemory(int method, size_t n);
+
+/*
+    Encodes n bytes into dst (at least blockBound(n) bytes), returns encoded size.
+*/
+size_t blockEncode(int method, const unsigned char* src, size_t n, unsigned char* dst);
+
+/*
+    Decodes block of size bytes into exactly n bytes, returns 0 or -1 on corrupted input.
+*/
+int blockDecode(const unsigned char* src, size_t size, unsigned char* dst, size_t n);
+
+#endif
@@ -0,0 +1,69 @@
+/***************************************************
+ * blockdekoder -- program to decode whole file or *
+ *                 only a range of it from output  *
+ *                 of blockkoder                   *
+ *                                                 *
+ * Usage:                                          *
+ *      blockdekoder input output [offset length]  *
+ *          - input: input file                    *
+ *          - output: output file                  *
+ *          - offset, length: decode only bytes    *
+ *            [offset, offset+length) of the       *
+ *            original file                        *
+ *                                                 *
+ * Only blocks overlapping the range are read and  *
+ * decoded.                                        *
+ ***************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "block/seekable.h"
+#include "common/iopipe.h"
+
+#define CHUNK IO_BUFFER_SIZE
+
+int main(int argc, char *argv[]){
+    if (argc != 3 && argc != 5){
+        fprintf(stderr, "Have to provide input and output file.\nExample: %s input_file output_file [offset length]\n", argv[0]);
+        return 0;
+    }
+
+    Seekable* s = seekOpen(argv[1]);
+    if (!s){
+        fprintf(stderr, "Can not open %s or it is not a block file\n", argv[1]);
+        return -1;
+    }
+    FILE* output = fopen(argv[2], "wb");
+    if (!output){
+        fprintf(stderr, "Can not open output file\n");
+        return -1;
+    }
+
+    unsigned long long offset = 0, length = s->size;
+    if (argc == 5){
+        offset = strtoull(argv[3], NULL, 10);
+        length = strtoull(argv[4], NULL, 10);
+    }
+
+    fprintf(stderr, "Decoding...\n");
+    // blocks are decoded straight into the buffers written in the background
+    IoPipe* out = ioWriter(fileno(output), IO_BUFFERS, CHUNK);
+    int error = 0;
+    while (length){
+        long long n = seekRead(s, offset, length < CHUNK ? length : CHUNK, ioBuffer(out));
+        if (n < 0) { error = 1; break; }
+        if (n == 0) break;
+        ioWrite(out, n);
+        offset += n;
+        length -= n;
+    }
+    int failed = ioClose(out);
+    fprintf(stderr, error ? "Corrupted input!\n" : failed ? "Failed!\n" : "Done!\n");
+
+    seekClose(s);
+    if (fclose(output)) failed = 1;
+    error |= failed;
+
+    return error ? -1 : 0;
+}
@@ -0,0 +1,106 @@
+/***************************************************
+ * blockkoder -- program to encode input file into *
+ *               independently coded blocks with   *
+ *               an index for random access        *
+ *                                                 *
+ * Usage:                                          *
+ *      blockkoder [-m method] [-b block] [-j n]   *
+ *                 [--max-memory size]             *
+ *                 input output                    *
+ *          - method: stored, huff, lzh, rans, bwt *
+ *            huff16 (16 bit samples) or auto      *
+ *            (default), which picks one per block *
+ *          - block: block size in bytes, 900 KiB  *
+ *            for bwt and 64 KiB for the others by *
+ *            default                              *
+ *          - n: number of threads                 *
+ *          - --max-memory: limit like 64M, met    *
+ *            with small I/O buffers, then fewer   *
+ *            threads, then halved blocks          *
+ *          - input: input file                    *
+ *          - output: output file                  *
+ ***************************************************/
+
+#include <stdio.h>
+#include <getopt.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include "block/block.h"
+#include "block/seekable.h"
+#include "bwt/bwt.h"
+#include "common/budget.h"
+#include "common/iopipe.h"
+#include "common/pool.h"
+
+#define MIN_BLOCK (4 * KiB)
+#define IO_CHUNK (64 * KiB)   // I/O buffers under a budget, 2 each way
+
+// every thread holds a block, its encoding and the coder's own memory
+static unsigned long long threadMemory(int method, long blockSize){
+    return blockSize + blockBound(blockSize) + blockMemory(method, blockSize);
+}
+
+int main(int argc, char *argv[]){
+    int method = BLOCK_AUTO;
+    long blockSize = 0;
+    int threads = poolThreads();
+    unsigned long long budget = 0;
+
+    static const struct option longOptions[] = {
+        { "max-memory", required_argument, NULL, 'M' },
+        { NULL, 0, NULL, 0 }
+    };
+    int opt;
+    while( (opt = getopt_long(argc, argv, "m:b:j:", longOptions, NULL)) != -1 ){
+        switch (opt) {
+            case 'm': method = blockMethod(optarg); break;
+            case 'b': blockSize = atol(optarg);     break;
+            case 'j': threads = atoi(optarg);       break;
+            case 'M': if (!(budget = budgetParse(optarg))) return -1; break;
+            default: return -1;
+        }
+    }
+    if (argc - optind != 2){
+        fprintf(stderr, "Have to provide input and output file.\nExample: %s [-m method] [-b block_size] [-j threads] [--max-memory size] input_file output_file\n", argv[0]);
+        return 0;
+    }
+    // sorting needs long blocks to find the context of a symbol
+    if (!blockSize) blockSize = method == BLOCK_BWT ? BWT_DEFAULT_BLOCK : SEEK_DEFAULT_BLOCK;
+    if (method < 0 || blockSize < 1 || blockSize > SEEK_MAX_BLOCK || threads < 1){
+        fprintf(stderr, "Invalid method, block size or number of threads\n");
+        return -1;
+    }
+    unsigned long long io = budget ? 4 * IO_CHUNK : 2ULL * IO_BUFFERS * IO_BUFFER_SIZE;
+    if (budget){
+        unsigned long long left = budget > io ? budget - io : 0;
+        while (threads > 1 && threads * threadMemory(method, blockSize) > left) threads--;
+        while (blockSize > MIN_BLOCK && threadMemory(method, blockSize) > left) blockSize /= 2;
+        if (threadMemory(method, blockSize) > left){
+            fprintf(stderr, "Memory budget too small, need at least %llu KiB\n", (io + threadMemory(method, blockSize)) / KiB + 1);
+            return -1;
+        }
+    }
+
+    FILE* input  = fopen(argv[optind], "rb");
+    FILE* output = fopen(argv[optind+1], "wb");
+    if (!input || !output){
+        fprintf(stderr, "Can not open input or output file\n");
+        return -1;
+    }
+
+    fprintf(stderr, "Encoding...\n");
+    int error = budget ? seekWrite(input, output, method, blockSize, threads, 2, IO_CHUNK)
+                       : seekWrite(input, output, method, blockSize, threads, IO_BUFFERS, IO_BUFFER_SIZE);
+    fprintf(stderr, error ? "Failed!\n" : "Done!\n");
+    if (budget){
+        char layout[64];
+        snprintf(layout, sizeof(layout), "%d x %ld byte blocks", threads, blockSize);
+        budgetReport(budget, io + threads * threadMemory(method, blockSize), layout);
+    }
+
+    fclose(input);
+    if (fclose(output)) error = -1;
+
+    return error ? -1 : 0;
+}
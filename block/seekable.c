@@ -0,0 +1,228 @@
+/***************************************************
+ * seekable -- block compressed file with an index *
+ *             for random access decompression     *
+ ***************************************************/
+
+#define _GNU_SOURCE
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+
+#include "block/block.h"
+#include "block/seekable.h"
+#include "common/iopipe.h"
+#include "common/pool.h"
+
+static void put64(IoPipe* p, unsigned long long x){
+    ioPutU32(p, x);
+    ioPutU32(p, x >> 32);
+}
+
+static unsigned int get32(const unsigned char* p){
+    return p[0] | p[1] << 8 | p[2] << 16 | (unsigned int) p[3] << 24;
+}
+
+static unsigned long long get64(const unsigned char* p){
+    return get32(p) | (unsigned long long) get32(p + 4) << 32;
+}
+
+typedef struct IndexEntry {
+    unsigned long long offset;
+    unsigned int size;
+    unsigned int original;
+} IndexEntry;
+
+typedef struct Batch {
+    int method;
+    unsigned char** in;
+    unsigned char** out;
+    size_t* original;
+    size_t* encoded;
+} Batch;
+
+static void encodeBlock(void* arg, int task, int worker){
+    Batch* b = (Batch*) arg;
+    b->encoded[task] = blockEncode(b->method, b->in[task], b->original[task], b->out[task]);
+}
+
+/*
+    Reads one block per thread, encodes them together and writes them in
+    order, so memory stays at two buffers per thread.
+*/
+int seekWrite(FILE* input, FILE* output, int method, unsigned int blockSize, int threads,
+              int buffers, size_t bufferSize){
+    Batch batch = { method };
+    IndexEntry* index = NULL;
+    int blocks = 0, capacity = 0, count, i;
+    unsigned long long offset = 4, size = 0;
+
+    batch.in = (unsigned char**) malloc(threads * sizeof(unsigned char*));
+    batch.out = (unsigned char**) malloc(threads * sizeof(unsigned char*));
+    batch.original = (size_t*) malloc(threads * sizeof(size_t));
+    batch.encoded = (size_t*) malloc(threads * sizeof(size_t));
+    for( i=0; i<threads; i++ ){
+        batch.in[i] = (unsigned char*) malloc(blockSize);
+        batch.out[i] = (unsigned char*) malloc(blockBound(blockSize));
+    }
+
+    fflush(output);
+    IoPipe* in = ioReader(fileno(input), buffers, bufferSize);
+    IoPipe* out = ioWriter(fileno(output), buffers, bufferSize);
+    ioPut(out, SEEK_MAGIC, 4);
+    do {
+        for( count=0; count<threads; count++ ){
+            batch.original[count] = ioGetSome(in, batch.in[count], blockSize);
+            if (!batch.original[count]) break;
+        }
+        poolRun(threads, count, encodeBlock, &batch);
+
+        for( i=0; i<count; i++ ){
+            ioPut(out, batch.out[i], batch.encoded[i]);
+
+            if (blocks == capacity){
+                capacity = capacity ? 2 * capacity : 64;
+                index = (IndexEntry*) realloc(index, capacity * sizeof(IndexEntry));
+            }
+            index[blocks].offset = offset;
+            index[blocks].size = batch.encoded[i];
+            index[blocks].original = batch.original[i];
+            blocks++;
+            offset += batch.encoded[i];
+            size += batch.original[i];
+        }
+    } while (count == threads);
+
+    ioPutU32(out, blocks);
+    for( i=0; i<blocks; i++ ){
+        put64(out, index[i].offset);
+        ioPutU32(out, index[i].size);
+        ioPutU32(out, index[i].original);
+    }
+    put64(out, offset);
+    put64(out, size);
+    ioPut(out, SEEK_MAGIC, 4);
+
+    int error = ioClose(in);
+    if (ioClose(out)) error = -1;
+
+    for( i=0; i<threads; i++ ){
+        free(batch.in[i]);
+        free(batch.out[i]);
+    }
+    free(batch.in);
+    free(batch.out);
+    free(batch.original);
+    free(batch.encoded);
+    free(index);
+    return error;
+}
+
+Seekable* seekOpen(const char* path){
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) return NULL;
+
+    struct stat st;
+    unsigned char footer[SEEK_FOOTER];
+    if (fstat(fd, &st) || st.st_size < 4 + 4 + SEEK_FOOTER
+            || pread(fd, footer, SEEK_FOOTER, st.st_size - SEEK_FOOTER) != SEEK_FOOTER
+            || memcmp(footer + 16, SEEK_MAGIC, 4)) {
+        close(fd);
+        return NULL;
+    }
+
+    unsigned long long start = get64(footer);
+    unsigned long long length = st.st_size - SEEK_FOOTER - start;
+    unsigned char count[4];
+    if (start < 4 || start + 4 > (unsigned long long) st.st_size - SEEK_FOOTER
+            || pread(fd, count, 4, start) != 4 || length != 4 + 16ULL * get32(count)) {
+        close(fd);
+        return NULL;
+    }
+
+    Seekable* s = (Seekable*) calloc(1, sizeof(Seekable));
+    s->fd = fd;
+    s->size = get64(footer + 8);
+    s->blocks = get32(count);
+    s->starts = (unsigned long long*) malloc((s->blocks + 1) * sizeof(unsigned long long));
+    s->offsets = (unsigned long long*) malloc((s->blocks + 1) * sizeof(unsigned long long));
+    s->sizes = (unsigned int*) malloc((s->blocks + 1) * sizeof(unsigned int));
+    s->cached = -1;
+
+    unsigned char* index = (unsigned char*) malloc(length);
+    int error = pread(fd, index, length, start) != (ssize_t) length;
+    unsigned int biggest = 1, biggestOriginal = 1;
+    int i;
+    s->starts[0] = 0;
+    for( i=0; i<s->blocks && !error; i++ ){
+        const unsigned char* p = index + 4 + 16 * i;
+        unsigned int original = get32(p + 12);
+        s->offsets[i] = get64(p);
+        s->sizes[i] = get32(p + 8);
+        s->starts[i+1] = s->starts[i] + original;
+        if (s->offsets[i] + s->sizes[i] > start || original > SEEK_MAX_BLOCK || s->sizes[i] > blockBound(SEEK_MAX_BLOCK)) error = 1;
+        if (s->sizes[i] > biggest) biggest = s->sizes[i];
+        if (original > biggestOriginal) biggestOriginal = original;
+    }
+    if (!error && s->starts[s->blocks] != s->size) error = 1;
+    free(index);
+
+    if (error){
+        seekClose(s);
+        return NULL;
+    }
+    s->in = (unsigned char*) malloc(biggest);
+    s->out = (unsigned char*) malloc(biggestOriginal);
+    return s;
+}
+
+void seekClose(Seekable* s){
+    close(s->fd);
+    free(s->starts);
+    free(s->offsets);
+    free(s->sizes);
+    free(s->in);
+    free(s->out);
+    free(s);
+}
+
+/*
+    Last block whose start is not after the offset.
+*/
+static int findBlock(const Seekable* s, unsigned long long offset){
+    int lo = 0, hi = s->blocks - 1;
+    while (lo < hi){
+        int mid = (lo + hi + 1) / 2;
+        if (s->starts[mid] <= offset) lo = mid;
+        else                          hi = mid - 1;
+    }
+    return lo;
+}
+
+static int loadBlock(Seekable* s, int b){
+    if (s->cached == b) return 0;
+    s->cached = -1;
+    if (pread(s->fd, s->in, s->sizes[b], s->offsets[b]) != (ssize_t) s->sizes[b]) return -1;
+    if (blockDecode(s->in, s->sizes[b], s->out, s->starts[b+1] - s->starts[b])) return -1;
+    s->cached = b;
+    return 0;
+}
+
+long long seekRead(Seekable* s, unsigned long long offset, unsigned long long len, unsigned char* dst){
+    if (offset >= s->size || !len) return 0;
+    if (len > s->size - offset) len = s->size - offset;
+
+    unsigned long long done = 0;
+    int b = findBlock(s, offset);
+    while (done < len){
+        if (loadBlock(s, b)) return -1;
+        unsigned long long from = offset + done - s->starts[b];
+        unsigned long long part = s->starts[b+1] - s->starts[b] - from;
+        if (part > len - done) part = len - done;
+        memcpy(dst + done, s->out + from, part);
+        done += part;
+        b++;
+    }
+    return done;
+}
@@ -0,0 +1,57 @@
+/***************************************************
+ * seekable -- block compressed file with an index *
+ *             for random access decompression     *
+ *                                                 *
+ * File:   "BLK1" block* index footer              *
+ * index:  u32 blocks, (u64 offset, u32 size,      *
+ *         u32 original size)*                     *
+ * footer: u64 index offset, u64 original size,    *
+ *         "BLK1"                                  *
+ * All integers are little endian.                 *
+ ***************************************************/
+
+#ifndef SEEKABLE_H
+#define SEEKABLE_H
+
+#include <stdio.h>
+
+#define SEEK_MAGIC "BLK1"
+#define SEEK_FOOTER 20
+#define SEEK_DEFAULT_BLOCK (1<<16)
+#define SEEK_MAX_BLOCK (1<<30)
+
+typedef struct Seekable {
+    int fd;
+    unsigned long long size;        // original size
+    int blocks;
+    unsigned long long* starts;     // original offset of each block, blocks+1 entries
+    unsigned long long* offsets;    // offset of each block in file
+    unsigned int* sizes;            // encoded size of each block
+    unsigned char* in;              // encoded block
+    unsigned char* out;             // last decoded block
+    int cached;                     // which block is in out, -1 if none
+} Seekable;
+
+/*
+    Compresses input into blocks of blockSize bytes, encoding as many
+    blocks at once as there are threads. File reads and writes go through
+    buffers of bufferSize bytes, that many each way. Returns 0 or -1 on
+    error.
+*/
+int seekWrite(FILE* input, FILE* output, int method, unsigned int blockSize, int threads,
+              int buffers, size_t bufferSize);
+
+/*
+    Opens seekable file and loads its index, returns NULL on error.
+*/
+Seekable* seekOpen(const char* path);
+void seekClose(Seekable* s);
+
+/*
+    Decompresses bytes [offset, offset+len) clipped to the original size,
+    decoding only the blocks that overlap them.
+    Returns number of bytes written to dst, -1 on corrupted input.
+*/
+long long seekRead(Seekable* s, unsigned long long offset, unsigned long long len, unsigned char* dst);
+
+#endif
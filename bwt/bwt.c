@@ -0,0 +1,297 @@
+/***************************************************
+ * bwt -- Burrows-Wheeler transform, move-to-front *
+ *        and zero run coding of in-memory blocks  *
+ *        in front of the Huffman coder            *
+ ***************************************************/
+
+#include <limits.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "bwt/bwt.h"
+#include "huff/huffman.h"
+
+// suffix array
+
+/*
+    Text being sorted: the block with byte+1 and a 0 sentinel at the end
+    on the first level, names of LMS substrings on the deeper ones.
+*/
+typedef struct Text {
+    const unsigned char* bytes;
+    const int* names;
+    int n;
+} Text;
+
+static inline int chr(const Text* s, int i){
+    if (s->names) return s->names[i];
+    return i == s->n - 1 ? 0 : s->bytes[i] + 1;
+}
+
+// t[i] is 1 for S-type suffixes (smaller than the next one), 0 for L-type
+#define isLMS(t, i) ((i) > 0 && (t)[i] && !(t)[(i)-1])
+
+static void buckets(const Text* s, int k, int* bkt, int end){
+    int i, sum = 0;
+    memset(bkt, 0, (k + 1) * sizeof(int));
+    for( i=0; i<s->n; i++ ) bkt[chr(s, i)]++;
+    for( i=0; i<=k; i++ ){
+        sum += bkt[i];
+        bkt[i] = end ? sum : sum - bkt[i];
+    }
+}
+
+static void induce(const Text* s, const unsigned char* t, int* sa, int k, int* bkt){
+    int i, j, n = s->n;
+
+    buckets(s, k, bkt, 0);
+    for( i=0; i<n; i++ ){
+        j = sa[i] - 1;
+        if (j >= 0 && !t[j]) sa[bkt[chr(s, j)]++] = j;
+    }
+    buckets(s, k, bkt, 1);
+    for( i=n-1; i>=0; i-- ){
+        j = sa[i] - 1;
+        if (j >= 0 && t[j]) sa[--bkt[chr(s, j)]] = j;
+    }
+}
+
+/*
+    Nong, Zhang and Chan: LMS substrings are sorted by induction, named,
+    and if the names are not unique their order comes from the suffix
+    array of the names, built the same way. Last symbol is the sentinel.
+*/
+static void sais(const Text* s, int* sa, int k){
+    int n = s->n, i, j;
+    unsigned char* t = (unsigned char*) malloc(n);
+    int* bkt = (int*) malloc((k + 1) * sizeof(int));
+
+    t[n-1] = 1;
+    t[n-2] = 0;
+    for( i=n-3; i>=0; i-- ){
+        int a = chr(s, i), b = chr(s, i+1);
+        t[i] = a < b || (a == b && t[i+1]);
+    }
+
+    // sort LMS substrings
+    buckets(s, k, bkt, 1);
+    for( i=0; i<n; i++ ) sa[i] = -1;
+    for( i=1; i<n; i++ ) if (isLMS(t, i)) sa[--bkt[chr(s, i)]] = i;
+    induce(s, t, sa, k, bkt);
+
+    int n1 = 0;
+    for( i=0; i<n; i++ ) if (isLMS(t, sa[i])) sa[n1++] = sa[i];
+
+    // equal LMS substrings get equal names, stored at n1 + position/2
+    int names = 0, prev = -1;
+    for( i=n1; i<n; i++ ) sa[i] = -1;
+    for( i=0; i<n1; i++ ){
+        int pos = sa[i], diff = 0, d;
+        for( d=0; d<n; d++ ){
+            if (prev < 0 || chr(s, pos+d) != chr(s, prev+d) || t[pos+d] != t[prev+d]) { diff = 1; break; }
+            if (d > 0 && (isLMS(t, pos+d) || isLMS(t, prev+d))) break;
+        }
+        if (diff) { names++; prev = pos; }
+        sa[n1 + pos/2] = names - 1;
+    }
+    for( i=n-1, j=n-1; i>=n1; i-- ) if (sa[i] >= 0) sa[j--] = sa[i];
+
+    // order of LMS suffixes
+    int* sa1 = sa;
+    int* s1 = sa + n - n1;
+    if (names < n1){
+        Text sub = { NULL, s1, n1 };
+        sais(&sub, sa1, names - 1);
+    } else {
+        for( i=0; i<n1; i++ ) sa1[s1[i]] = i;
+    }
+
+    // put sorted LMS suffixes at the ends of their buckets and induce the rest
+    buckets(s, k, bkt, 1);
+    for( i=1, j=0; i<n; i++ ) if (isLMS(t, i)) s1[j++] = i;
+    for( i=0; i<n1; i++ ) sa1[i] = s1[sa1[i]];
+    for( i=n1; i<n; i++ ) sa[i] = -1;
+    for( i=n1-1; i>=0; i-- ){
+        j = sa[i];
+        sa[i] = -1;
+        sa[--bkt[chr(s, j)]] = j;
+    }
+    induce(s, t, sa, k, bkt);
+
+    free(bkt);
+    free(t);
+}
+
+void bwtSuffixArray(const unsigned char* src, int n, int* sa){
+    Text s = { src, NULL, n + 1 };
+    if (!n) { sa[0] = 0; return; }
+    sais(&s, sa, 256);
+}
+
+// transform
+
+int bwtForward(const unsigned char* src, int n, unsigned char* dst){
+    int* sa = (int*) malloc((n + 1) * sizeof(int));
+    int i, j = 0, primary = 0;
+
+    bwtSuffixArray(src, n, sa);
+    for( i=0; i<=n; i++ ){
+        if (sa[i]) dst[j++] = src[sa[i] - 1];
+        else       primary = i;
+    }
+
+    free(sa);
+    return primary;
+}
+
+/*
+    Rows are sorted rotations of the block with the sentinel, src is their
+    last column without the sentinel row. next[j] is the row whose last
+    symbol is the first symbol of row j, that is the rotation one further.
+    Row primary starts at the beginning of the block.
+*/
+void bwtInverse(const unsigned char* src, int n, int primary, unsigned char* dst){
+    unsigned int* next = (unsigned int*) malloc((n + 1) * sizeof(unsigned int));
+    unsigned int start[256];
+    int i, c, sum = 1;
+
+    memset(start, 0, sizeof(start));
+    for( i=0; i<n; i++ ) start[src[i]]++;
+    for( c=0; c<256; c++ ){
+        int count = start[c];
+        start[c] = sum;
+        sum += count;
+    }
+
+    next[0] = primary;
+    for( i=0; i<=n; i++ ){
+        if (i == primary) continue;
+        next[start[src[i < primary ? i : i-1]]++] = i;
+    }
+
+    unsigned int j = primary;
+    for( i=0; i<n; i++ ){
+        j = next[j];
+        dst[i] = src[j < (unsigned int) primary ? j : j-1];
+    }
+
+    free(next);
+}
+
+// coding
+
+static void put32(unsigned char* p, unsigned int x){
+    p[0] = x; p[1] = x >> 8; p[2] = x >> 16; p[3] = x >> 24;
+}
+
+static unsigned int get32(const unsigned char* p){
+    return p[0] | p[1] << 8 | p[2] << 16 | (unsigned int) p[3] << 24;
+}
+
+/*
+    Run of length run as RUNA (1) and RUNB (2) digits, least significant first.
+*/
+static size_t putRun(unsigned short* symbols, size_t count, size_t run){
+    run--;
+    for(;;){
+        symbols[count++] = run & 1 ? BWT_RUNB : BWT_RUNA;
+        if (run < 2) break;
+        run = (run - 2) / 2;
+    }
+    return count;
+}
+
+size_t bwtEncode(const unsigned char* src, size_t n, unsigned char* dst, size_t capacity){
+    if (capacity < 4 || n >= INT_MAX) return 0;
+
+    unsigned char* last = (unsigned char*) malloc(n);
+    unsigned short* symbols = (unsigned short*) malloc(n * sizeof(unsigned short));
+    unsigned char order[256];
+    huff_freq_t freqs[BWT_SYMBOLS] = { 0 };
+    unsigned char lengths[BWT_SYMBOLS];
+    size_t i, count = 0, run = 0;
+    HuffEncoder e;
+    BitWriter w;
+
+    int primary = bwtForward(src, n, last);
+
+    // move-to-front, a symbol at the front is a zero and joins the run
+    for( i=0; i<256; i++ ) order[i] = i;
+    for( i=0; i<n; i++ ){
+        unsigned char c = last[i];
+        if (order[0] == c) { run++; continue; }
+        if (run) { count = putRun(symbols, count, run); run = 0; }
+
+        int rank = 1;
+        while (order[rank] != c) rank++;
+        memmove(order + 1, order, rank);
+        order[0] = c;
+        symbols[count++] = rank + 1;
+    }
+    if (run) count = putRun(symbols, count, run);
+
+    for( i=0; i<count; i++ ) freqs[symbols[i]]++;
+    huffLengths(freqs, BWT_SYMBOLS, HUFF_MAX_BITS, lengths);
+    huffBuildEncoder(&e, lengths, BWT_SYMBOLS);
+
+    put32(dst, primary);
+    initBitWriter(&w, dst + 4, capacity - 4);
+    huffWriteLengths(&w, lengths, BWT_SYMBOLS);
+    for( i=0; i<count && !w.overflow; i++ ) huffPut(&w, &e, symbols[i]);
+    size_t size = flushBits(&w) + 4;
+
+    free(symbols);
+    free(last);
+    return w.overflow ? 0 : size;
+}
+
+int bwtDecode(const unsigned char* src, size_t size, unsigned char* dst, size_t n){
+    if (size < 4 || n >= INT_MAX) return -1;
+    size_t primary = get32(src);
+    if (n && (primary < 1 || primary > n)) return -1;
+
+    unsigned char lengths[BWT_SYMBOLS];
+    HuffDecoder d;
+    BitReader r;
+
+    initBitReader(&r, src + 4, size - 4);
+    if (huffReadLengths(&r, lengths, BWT_SYMBOLS) || huffBuildDecoder(&d, lengths, BWT_SYMBOLS)) return -1;
+
+    unsigned char* last = (unsigned char*) malloc(n ? n : 1);
+    unsigned char order[256];
+    size_t i, out = 0, run = 0, weight = 1;
+    int error = 0;
+
+    for( i=0; i<256; i++ ) order[i] = i;
+    while (out < n){
+        int symbol = huffGet(&r, &d);
+        if (symbol < 0) { error = 1; break; }
+
+        // run ends with the next rank, or when it fills the block
+        if (symbol <= BWT_RUNB){
+            run += weight << symbol;
+            weight <<= 1;
+            if (run > n - out) { error = 1; break; }
+            if (run < n - out) continue;
+        }
+        if (run){
+            memset(last + out, order[0], run);
+            out += run;
+            run = 0;
+            weight = 1;
+        }
+        if (symbol <= BWT_RUNB) continue;
+        if (out == n) { error = 1; break; }
+
+        int rank = symbol - 1;
+        unsigned char c = order[rank];
+        memmove(order + 1, order, rank);
+        order[0] = c;
+        last[out++] = c;
+    }
+    if (overrun(&r)) error = 1;
+
+    if (!error) bwtInverse(last, n, primary, dst);
+    free(last);
+    return error ? -1 : 0;
+}
@@ -0,0 +1,49 @@
+/***************************************************
+ * bwt -- Burrows-Wheeler transform, move-to-front *
+ *        and zero run coding of in-memory blocks  *
+ *        in front of the Huffman coder            *
+ *                                                 *
+ * Suffix array is built with SA-IS in linear      *
+ * time. Transformed block is move-to-front coded, *
+ * runs of zeros become RUNA/RUNB digits of their  *
+ * length (bijective base 2) and the other ranks r *
+ * symbols r+1, all coded with one Huffman table.  *
+ *                                                 *
+ * Payload: u32 primary index, code lengths,       *
+ *          symbols                                *
+ ***************************************************/
+
+#ifndef BWT_H
+#define BWT_H
+
+#include <stddef.h>
+
+#define BWT_RUNA 0
+#define BWT_RUNB 1
+#define BWT_SYMBOLS 257
+#define BWT_DEFAULT_BLOCK (900<<10)
+
+/*
+    Builds suffix array of n bytes into sa (n+1 entries). Suffixes are
+    ended by a sentinel smaller than any byte, sa[0] is always n.
+*/
+void bwtSuffixArray(const unsigned char* src, int n, int* sa);
+
+/*
+    Writes transform of n bytes into dst (n bytes), without the sentinel.
+    Returns primary index, the row that ends with the sentinel.
+*/
+int bwtForward(const unsigned char* src, int n, unsigned char* dst);
+void bwtInverse(const unsigned char* src, int n, int primary, unsigned char* dst);
+
+/*
+    Encodes n bytes, returns payload size, 0 if it does not fit in capacity.
+*/
+size_t bwtEncode(const unsigned char* src, size_t n, unsigned char* dst, size_t capacity);
+
+/*
+    Decodes exactly n bytes, returns 0 or -1 on corrupted input.
+*/
+int bwtDecode(const unsigned char* src, size_t size, unsigned char* dst, size_t n);
+
+#endif
@@ -0,0 +1,32 @@
+/***************************************************
+ * budget -- memory limit given on the command     *
+ *           line and the report of actual usage   *
+ ***************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/resource.h>
+
+#include "common/budget.h"
+
+unsigned long long budgetParse(const char* s){
+    char* end;
+    unsigned long long x = strtoull(s, &end, 10);
+    switch (*end) {
+        case 'k': case 'K': x <<= 10; end++; break;
+        case 'm': case 'M': x <<= 20; end++; break;
+        case 'g': case 'G': x <<= 30; end++; break;
+    }
+    return *end || end == s ? 0 : x;
+}
+
+unsigned long long budgetPeak(void){
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage)) return 0;
+    return (unsigned long long) usage.ru_maxrss * KiB;
+}
+
+void budgetReport(unsigned long long budget, unsigned long long planned, const char* layout){
+    fprintf(stderr, "Memory: budget %llu KiB, %s uses %llu KiB, peak RSS %llu KiB\n",
+        budget / KiB, layout, planned / KiB, budgetPeak() / KiB);
+}
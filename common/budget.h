@@ -0,0 +1,34 @@
+/***************************************************
+ * budget -- memory limit given on the command     *
+ *           line and the report of actual usage   *
+ *                                                 *
+ * Codecs pick their dictionary size, block size   *
+ * and layout so that what they allocate fits the  *
+ * budget. Peak RSS in the report also counts the  *
+ * program itself (code, libc, stacks).            *
+ ***************************************************/
+
+#ifndef BUDGET_H
+#define BUDGET_H
+
+#include <stddef.h>
+
+#define KiB (1ULL<<10)
+
+/*
+    Parses sizes like 65536, 512K, 64M or 1G, returns 0 if invalid.
+*/
+unsigned long long budgetParse(const char* s);
+
+/*
+    Peak resident set size of the process so far, in bytes.
+*/
+unsigned long long budgetPeak(void);
+
+/*
+    Prints budget, what the codec planned to allocate with which layout,
+    and peak RSS to stderr.
+*/
+void budgetReport(unsigned long long budget, unsigned long long planned, const char* layout);
+
+#endif
@@ -0,0 +1,472 @@
+/***************************************************
+ * iopipe -- reading and writing files through a   *
+ *           ring of buffers in the background     *
+ ***************************************************/
+
+#define _GNU_SOURCE
+#include <errno.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#ifndef NO_URING
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#endif
+
+#include "common/iopipe.h"
+#include "common/queue.h"
+
+typedef struct Buffer {
+    unsigned char* data;
+    long len;                       // bytes in it, -1 after a failed read
+    unsigned long long offset;      // where in the file (io_uring)
+    int busy;                       // read or write in flight (io_uring)
+} Buffer;
+
+#ifndef NO_URING
+typedef struct Ring {
+    int fd;
+    unsigned* sqTail;
+    unsigned* sqMask;
+    unsigned* sqArray;
+    struct io_uring_sqe* sqes;
+    unsigned* cqHead;
+    unsigned* cqTail;
+    unsigned* cqMask;
+    struct io_uring_cqe* cqes;
+    void* sqMap;
+    void* cqMap;
+    size_t sqSize;
+    size_t cqSize;
+    size_t sqesSize;
+} Ring;
+#endif
+
+struct IoPipe {
+    int fd;
+    int writer;
+    int uring;
+    int count;
+    size_t size;
+    Buffer* buffers;
+    int error;
+
+    Buffer* current;                // held by the codec
+    size_t pos;                     // writer: bytes put in current
+    const unsigned char* data;      // reader: what ioGet has not used yet
+    size_t avail;
+    long long start;                // file position at open, -1 if not seekable
+    unsigned long long consumed;    // bytes handed out by reader
+
+    // threads
+    Queue* free;
+    Queue* full;
+    pthread_t thread;
+
+    // io_uring
+#ifndef NO_URING
+    Ring ring;
+#endif
+    int next;                       // buffer to hand out next
+    int inflight;
+    int eof;
+    unsigned long long offset;      // file offset of the next read or write
+};
+
+static long readFull(int fd, unsigned char* dst, size_t n){
+    size_t done = 0;
+    while (done < n){
+        ssize_t k = read(fd, dst + done, n - done);
+        if (k < 0 && errno == EINTR) continue;
+        if (k < 0) return -1;
+        if (k == 0) break;
+        done += k;
+    }
+    return done;
+}
+
+static int writeFull(int fd, const unsigned char* src, size_t n){
+    while (n){
+        ssize_t k = write(fd, src, n);
+        if (k < 0 && errno == EINTR) continue;
+        if (k <= 0) return -1;
+        src += k;
+        n -= k;
+    }
+    return 0;
+}
+
+// threads
+
+static void* readStage(void* arg){
+    IoPipe* p = (IoPipe*) arg;
+    Buffer* b;
+    while( (b = (Buffer*) queuePop(p->free)) ){
+        b->len = readFull(p->fd, b->data, p->size);
+        queuePush(p->full, b);
+        if (b->len < (long) p->size) break;
+    }
+    queueClose(p->full);
+    return NULL;
+}
+
+static void* writeStage(void* arg){
+    IoPipe* p = (IoPipe*) arg;
+    Buffer* b;
+    while( (b = (Buffer*) queuePop(p->full)) ){
+        if (writeFull(p->fd, b->data, b->len)) p->error = 1;
+        queuePush(p->free, b);
+    }
+    return NULL;
+}
+
+// io_uring, through raw system calls
+
+#ifndef NO_URING
+static int ringInit(Ring* r, unsigned entries){
+    struct io_uring_params params;
+    memset(&params, 0, sizeof(params));
+    r->fd = syscall(__NR_io_uring_setup, entries, &params);
+    if (r->fd < 0) return -1;
+
+    r->sqSize = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    r->cqSize = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+    r->sqesSize = params.sq_entries * sizeof(struct io_uring_sqe);
+    int single = params.features & IORING_FEAT_SINGLE_MMAP;
+    if (single && r->cqSize > r->sqSize) r->sqSize = r->cqSize;
+
+    r->sqMap = mmap(NULL, r->sqSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, r->fd, IORING_OFF_SQ_RING);
+    r->cqMap = single ? r->sqMap
+                      : mmap(NULL, r->cqSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, r->fd, IORING_OFF_CQ_RING);
+    r->sqes = (struct io_uring_sqe*) mmap(NULL, r->sqesSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, r->fd, IORING_OFF_SQES);
+    if (r->sqMap == MAP_FAILED || r->cqMap == MAP_FAILED || r->sqes == MAP_FAILED){
+        if (r->sqes != MAP_FAILED) munmap(r->sqes, r->sqesSize);
+        if (!single && r->cqMap != MAP_FAILED) munmap(r->cqMap, r->cqSize);
+        if (r->sqMap != MAP_FAILED) munmap(r->sqMap, r->sqSize);
+        close(r->fd);
+        return -1;
+    }
+
+    char* sq = (char*) r->sqMap;
+    char* cq = (char*) r->cqMap;
+    r->sqTail = (unsigned*) (sq + params.sq_off.tail);
+    r->sqMask = (unsigned*) (sq + params.sq_off.ring_mask);
+    r->sqArray = (unsigned*) (sq + params.sq_off.array);
+    r->cqHead = (unsigned*) (cq + params.cq_off.head);
+    r->cqTail = (unsigned*) (cq + params.cq_off.tail);
+    r->cqMask = (unsigned*) (cq + params.cq_off.ring_mask);
+    r->cqes = (struct io_uring_cqe*) (cq + params.cq_off.cqes);
+    return 0;
+}
+
+/*
+    IORING_OP_READ and IORING_OP_WRITE came with Linux 5.6, older rings
+    accept them and fail every one with -EINVAL. Probing came in the same
+    release, so a ring that can not be probed is not used either.
+*/
+static int ringSupported(Ring* r){
+    size_t size = sizeof(struct io_uring_probe) + (IORING_OP_WRITE + 1) * sizeof(struct io_uring_probe_op);
+    struct io_uring_probe* probe = (struct io_uring_probe*) calloc(1, size);
+    if (!probe) return 0;
+
+    int ok = syscall(__NR_io_uring_register, r->fd, IORING_REGISTER_PROBE, probe, IORING_OP_WRITE + 1) >= 0
+          && probe->last_op >= IORING_OP_WRITE
+          && (probe->ops[IORING_OP_READ].flags & IO_URING_OP_SUPPORTED)
+          && (probe->ops[IORING_OP_WRITE].flags & IO_URING_OP_SUPPORTED);
+    free(probe);
+    return ok;
+}
+
+static void ringDestroy(Ring* r){
+    munmap(r->sqes, r->sqesSize);
+    if (r->cqMap != r->sqMap) munmap(r->cqMap, r->cqSize);
+    munmap(r->sqMap, r->sqSize);
+    close(r->fd);
+}
+
+static int ringEnter(Ring* r, unsigned submit, unsigned wait){
+    for(;;){
+        long k = syscall(__NR_io_uring_enter, r->fd, submit, wait, wait ? IORING_ENTER_GETEVENTS : 0, NULL, 0);
+        if (k >= 0) return 0;
+        if (errno != EINTR) return -1;
+    }
+}
+
+static int ringSubmit(Ring* r, int op, int fd, void* data, unsigned len, unsigned long long offset, unsigned long long tag){
+    unsigned tail = *r->sqTail;
+    unsigned idx = tail & *r->sqMask;
+    struct io_uring_sqe* sqe = &r->sqes[idx];
+
+    memset(sqe, 0, sizeof(*sqe));
+    sqe->opcode = op;
+    sqe->fd = fd;
+    sqe->addr = (unsigned long) data;
+    sqe->len = len;
+    sqe->off = offset;
+    sqe->user_data = tag;
+    r->sqArray[idx] = idx;
+    __atomic_store_n(r->sqTail, tail + 1, __ATOMIC_RELEASE);
+    return ringEnter(r, 1, 0);
+}
+
+/*
+    Waits for one completion, returns its result and stores its tag.
+*/
+static int ringWait(Ring* r, unsigned long long* tag){
+    unsigned head = *r->cqHead;
+    while (head == __atomic_load_n(r->cqTail, __ATOMIC_ACQUIRE))
+        if (ringEnter(r, 0, 1)) return -1;
+
+    struct io_uring_cqe* cqe = &r->cqes[head & *r->cqMask];
+    int res = cqe->res;
+    *tag = cqe->user_data;
+    __atomic_store_n(r->cqHead, head + 1, __ATOMIC_RELEASE);
+    return res;
+}
+
+static void submitRead(IoPipe* p, Buffer* b){
+    if (p->eof) { b->len = 0; return; }
+    b->offset = p->offset;
+    p->offset += p->size;
+    b->busy = 1;
+    p->inflight++;
+    if (ringSubmit(&p->ring, IORING_OP_READ, p->fd, b->data, p->size, b->offset, b - p->buffers)) p->error = 1;
+}
+
+/*
+    Short reads and writes are finished with plain calls, they only
+    happen at the end of file or on errors.
+*/
+static void reap(IoPipe* p){
+    unsigned long long tag = 0;
+    int res = ringWait(&p->ring, &tag);
+    if (tag >= (unsigned long long) p->count || !p->buffers[tag].busy){
+        // ring is broken, nothing more will complete
+        p->error = 1;
+        p->inflight = 0;
+        return;
+    }
+
+    Buffer* b = &p->buffers[tag];
+    b->busy = 0;
+    p->inflight--;
+    if (!p->writer) { b->len = res; return; }
+
+    if (res < 0) { p->error = 1; return; }
+    while (res < b->len){
+        ssize_t k = pwrite(p->fd, b->data + res, b->len - res, b->offset + res);
+        if (k < 0 && errno == EINTR) continue;
+        if (k <= 0) { p->error = 1; return; }
+        res += k;
+    }
+}
+
+static const unsigned char* uringRead(IoPipe* p, size_t* n){
+    if (p->current) { submitRead(p, p->current); p->current = NULL; }
+
+    Buffer* b = &p->buffers[p->next];
+    while (b->busy && !p->error) reap(p);
+    if (p->error || b->busy || b->len < 0) { p->error = 1; return NULL; }
+
+    if ((size_t) b->len < p->size){
+        while ((size_t) b->len < p->size){
+            ssize_t k = pread(p->fd, b->data + b->len, p->size - b->len, b->offset + b->len);
+            if (k < 0 && errno == EINTR) continue;
+            if (k < 0) { p->error = 1; return NULL; }
+            if (k == 0) break;
+            b->len += k;
+        }
+        if ((size_t) b->len < p->size) p->eof = 1;
+    }
+    if (!b->len) return NULL;
+
+    p->current = b;
+    p->next = (p->next + 1) % p->count;
+    *n = b->len;
+    return b->data;
+}
+
+static int uringOpen(IoPipe* p){
+    struct stat st;
+    if (p->start < 0 || fstat(p->fd, &st) || !S_ISREG(st.st_mode)) return -1;
+    if (ringInit(&p->ring, p->count)) return -1;
+    if (!ringSupported(&p->ring)) { ringDestroy(&p->ring); return -1; }
+
+    int i;
+    p->uring = 1;
+    p->offset = p->start;
+    if (!p->writer) for( i=0; i<p->count; i++ ) submitRead(p, &p->buffers[i]);
+    return 0;
+}
+#endif
+
+// pipe
+
+static IoPipe* ioOpen(int fd, int buffers, size_t size, int writer){
+    IoPipe* p = (IoPipe*) calloc(1, sizeof(IoPipe));
+    int i;
+
+    p->fd = fd;
+    p->writer = writer;
+    p->count = buffers;
+    p->size = size;
+    p->start = lseek(fd, 0, SEEK_CUR);
+    p->buffers = (Buffer*) calloc(buffers, sizeof(Buffer));
+    for( i=0; i<buffers; i++ ){
+        p->buffers[i].data = (unsigned char*) malloc(size);
+        if (!p->buffers[i].data) { p->error = 1; ioClose(p); return NULL; }
+    }
+
+#ifndef NO_URING
+    if (!uringOpen(p)) return p;
+#endif
+
+    p->free = newQueue(buffers);
+    p->full = newQueue(buffers);
+    for( i=0; i<buffers; i++ ) queuePush(p->free, &p->buffers[i]);
+    pthread_create(&p->thread, NULL, writer ? writeStage : readStage, p);
+    return p;
+}
+
+IoPipe* ioReader(int fd, int buffers, size_t size){
+    return ioOpen(fd, buffers, size, 0);
+}
+
+IoPipe* ioWriter(int fd, int buffers, size_t size){
+    return ioOpen(fd, buffers, size, 1);
+}
+
+const char* ioBackend(const IoPipe* p){
+    return p->uring ? "io_uring" : "threads";
+}
+
+const unsigned char* ioRead(IoPipe* p, size_t* n){
+    const unsigned char* data = NULL;
+    if (p->avail){  // rest of a buffer ioGet started
+        *n = p->avail;
+        p->avail = 0;
+        return p->data;
+    }
+#ifndef NO_URING
+    if (p->uring) data = uringRead(p, n);
+    else
+#endif
+    {
+        if (p->current) queuePush(p->free, p->current);
+        p->current = (Buffer*) queuePop(p->full);
+        if (p->current && p->current->len < 0) p->error = 1;
+        else if (p->current && p->current->len > 0) {
+            data = p->current->data;
+            *n = p->current->len;
+        }
+    }
+    if (data) p->consumed += *n;
+    return data;
+}
+
+size_t ioGetSome(IoPipe* p, void* dst, size_t n){
+    unsigned char* out = (unsigned char*) dst;
+    size_t done = 0;
+    while (done < n){
+        if (!p->avail && !(p->data = ioRead(p, &p->avail))) { p->avail = 0; break; }
+        size_t k = n - done < p->avail ? n - done : p->avail;
+        memcpy(out + done, p->data, k);
+        p->data += k;
+        p->avail -= k;
+        done += k;
+    }
+    return done;
+}
+
+int ioGet(IoPipe* p, void* dst, size_t n){
+    return ioGetSome(p, dst, n) == n;
+}
+
+unsigned char* ioBuffer(IoPipe* p){
+    if (!p->current){
+#ifndef NO_URING
+        if (p->uring){
+            Buffer* b = &p->buffers[p->next];
+            while (b->busy && !p->error) reap(p);
+            p->next = (p->next + 1) % p->count;
+            p->current = b;
+        } else
+#endif
+        p->current = (Buffer*) queuePop(p->free);
+    }
+    return p->current->data;
+}
+
+void ioWrite(IoPipe* p, size_t n){
+    Buffer* b = p->current;
+    p->current = NULL;
+    p->pos = 0;
+    if (!b) return;
+    if (!n){
+        // nothing to write, the threads backend gets its buffer back,
+        // io_uring ones are taken in turn and only wait while busy
+#ifndef NO_URING
+        if (!p->uring)
+#endif
+        queuePush(p->free, b);
+        return;
+    }
+    b->len = n;
+
+#ifndef NO_URING
+    if (p->uring){
+        b->offset = p->offset;
+        p->offset += n;
+        b->busy = 1;
+        p->inflight++;
+        if (ringSubmit(&p->ring, IORING_OP_WRITE, p->fd, b->data, n, b->offset, b - p->buffers)) p->error = 1;
+        return;
+    }
+#endif
+    queuePush(p->full, b);
+}
+
+void ioPut(IoPipe* p, const void* src, size_t n){
+    const unsigned char* in = (const unsigned char*) src;
+    while (n){
+        unsigned char* buffer = ioBuffer(p);
+        size_t k = n < p->size - p->pos ? n : p->size - p->pos;
+        memcpy(buffer + p->pos, in, k);
+        p->pos += k;
+        in += k;
+        n -= k;
+        if (p->pos == p->size) ioWrite(p, p->size);
+    }
+}
+
+int ioClose(IoPipe* p){
+    int i;
+    if (p->writer && p->pos) ioWrite(p, p->pos);
+
+#ifndef NO_URING
+    if (p->uring){
+        while (p->inflight) reap(p);
+        ringDestroy(&p->ring);
+        if (p->writer) lseek(p->fd, p->offset, SEEK_SET);
+    } else
+#endif
+    if (p->full){
+        if (!p->writer) queueClose(p->free);
+        queueClose(p->full);
+        pthread_join(p->thread, NULL);
+        destroyQueue(p->free);
+        destroyQueue(p->full);
+    }
+    // consumed counts whole buffers, ioGet may have left some of the last unread
+    if (!p->writer && p->start >= 0) lseek(p->fd, p->start + p->consumed - p->avail, SEEK_SET);
+
+    int error = p->error;
+    for( i=0; i<p->count; i++ ) free(p->buffers[i].data);
+    free(p->buffers);
+    free(p);
+    return error ? -1 : 0;
+}
@@ -0,0 +1,89 @@
+/***************************************************
+ * iopipe -- reading and writing files through a   *
+ *           ring of buffers in the background     *
+ *                                                 *
+ * Reader keeps every buffer the codec does not    *
+ * hold filled ahead, writer drains the buffers    *
+ * codec has handed over, so disk waits overlap    *
+ * with coding. Regular files go through io_uring  *
+ * when the kernel allows it, everything else      *
+ * (pipes, old kernels, -DNO_URING) through one    *
+ * I/O thread per pipe.                            *
+ ***************************************************/
+
+#ifndef IOPIPE_H
+#define IOPIPE_H
+
+#include <stddef.h>
+
+#define IO_BUFFERS 4
+#define IO_BUFFER_SIZE (1<<20)
+
+typedef struct IoPipe IoPipe;
+
+/*
+    Starts reading fd from its current position, or writing fd at its
+    current position. Returns NULL if buffers can not be allocated.
+*/
+IoPipe* ioReader(int fd, int buffers, size_t size);
+IoPipe* ioWriter(int fd, int buffers, size_t size);
+
+/*
+    Name of the backend in use, "io_uring" or "threads".
+*/
+const char* ioBackend(const IoPipe* p);
+
+/*
+    Returns next filled buffer and its length, NULL at the end of file or
+    on error. Buffer stays valid until the next call. All but the last
+    buffer are full, except that the rest of a buffer ioGet has started
+    on comes back first.
+*/
+const unsigned char* ioRead(IoPipe* p, size_t* n);
+
+/*
+    Reads exactly n bytes, possibly across buffers.
+    Returns 0 if the file ends before that.
+*/
+int ioGet(IoPipe* p, void* dst, size_t n);
+
+/*
+    Reads up to n bytes, fewer only at the end of file.
+    Returns number of bytes read.
+*/
+size_t ioGetSome(IoPipe* p, void* dst, size_t n);
+
+/*
+    Buffer to be filled, of the size given at ioWriter.
+    ioWrite queues its first n bytes and the next ioBuffer gives a new one.
+*/
+unsigned char* ioBuffer(IoPipe* p);
+void ioWrite(IoPipe* p, size_t n);
+
+/*
+    Copies n bytes into the buffers, queueing the ones that fill up.
+*/
+void ioPut(IoPipe* p, const void* src, size_t n);
+
+/*
+    Writer: queues what was put and waits for all writes.
+    Reader: stops reading, fd is left after the last byte handed out.
+    Returns 0 or -1 if some read or write failed.
+*/
+int ioClose(IoPipe* p);
+
+// little endian u32, the length prefix of the block formats
+
+static inline void ioPutU32(IoPipe* p, unsigned int x){
+    unsigned char b[4] = { x, x >> 8, x >> 16, x >> 24 };
+    ioPut(p, b, 4);
+}
+
+static inline int ioGetU32(IoPipe* p, unsigned int* x){
+    unsigned char b[4];
+    if (!ioGet(p, b, 4)) return 0;
+    *x = b[0] | b[1] << 8 | b[2] << 16 | (unsigned int) b[3] << 24;
+    return 1;
+}
+
+#endif
@@ -0,0 +1,113 @@
+/***************************************************
+ * pool -- work-stealing thread pool for a fixed   *
+ *         number of independent tasks             *
+ ***************************************************/
+
+#include <stdlib.h>
+#include <unistd.h>
+#include <pthread.h>
+
+#include "common/pool.h"
+
+typedef struct Range {
+    int lo;
+    int hi;
+    pthread_mutex_t lock;
+} Range;
+
+typedef struct Pool {
+    int threads;
+    Range* ranges;
+    pool_task_t fn;
+    void* arg;
+} Pool;
+
+typedef struct Worker {
+    Pool* pool;
+    int id;
+} Worker;
+
+int poolThreads(void){
+    long n = sysconf(_SC_NPROCESSORS_ONLN);
+    return n > 0 ? n : 1;
+}
+
+static int take(Range* r){
+    int task = -1;
+    pthread_mutex_lock(&r->lock);
+    if (r->lo < r->hi) task = r->lo++;
+    pthread_mutex_unlock(&r->lock);
+    return task;
+}
+
+/*
+    Moves back half of some victim's range to the thief, returns first stolen task.
+*/
+static int steal(Pool* p, int thief){
+    int k;
+    for( k=1; k<p->threads; k++ ){
+        Range* victim = &p->ranges[(thief + k) % p->threads];
+        int lo = 0, hi = 0;
+
+        pthread_mutex_lock(&victim->lock);
+        if (victim->lo < victim->hi){
+            hi = victim->hi;
+            lo = hi - (hi - victim->lo + 1) / 2;
+            victim->hi = lo;
+        }
+        pthread_mutex_unlock(&victim->lock);
+
+        if (lo < hi){
+            Range* own = &p->ranges[thief];
+            pthread_mutex_lock(&own->lock);
+            own->lo = lo + 1;
+            own->hi = hi;
+            pthread_mutex_unlock(&own->lock);
+            return lo;
+        }
+    }
+    return -1;
+}
+
+static void* work(void* arg){
+    Worker* w = (Worker*) arg;
+    Pool* p = w->pool;
+    for(;;){
+        int task = take(&p->ranges[w->id]);
+        if (task < 0) task = steal(p, w->id);
+        if (task < 0) break;
+        p->fn(p->arg, task, w->id);
+    }
+    return NULL;
+}
+
+void poolRun(int threads, int tasks, pool_task_t fn, void* arg){
+    if (threads < 1) threads = 1;
+    if (threads > tasks) threads = tasks > 0 ? tasks : 1;
+
+    Pool p;
+    p.threads = threads;
+    p.ranges = (Range*) malloc(threads * sizeof(Range));
+    p.fn = fn;
+    p.arg = arg;
+
+    Worker* workers = (Worker*) malloc(threads * sizeof(Worker));
+    pthread_t* ids = (pthread_t*) malloc(threads * sizeof(pthread_t));
+    int i;
+    for( i=0; i<threads; i++ ){
+        p.ranges[i].lo = (long long) tasks * i / threads;
+        p.ranges[i].hi = (long long) tasks * (i+1) / threads;
+        pthread_mutex_init(&p.ranges[i].lock, NULL);
+        workers[i].pool = &p;
+        workers[i].id = i;
+    }
+
+    for( i=1; i<threads; i++ ) pthread_create(&ids[i], NULL, work, &workers[i]);
+    work(&workers[0]);
+    for( i=1; i<threads; i++ ) pthread_join(ids[i], NULL);
+
+    for( i=0; i<threads; i++ ) pthread_mutex_destroy(&p.ranges[i].lock);
+    free(ids);
+    free(workers);
+    free(p.ranges);
+}
@@ -0,0 +1,27 @@
+/***************************************************
+ * pool -- work-stealing thread pool for a fixed   *
+ *         number of independent tasks             *
+ *                                                 *
+ * Tasks 0..n-1 are split into one contiguous      *
+ * range per worker. Worker takes tasks from the   *
+ * front of its range; when it runs dry it steals  *
+ * the back half of some other worker's range.     *
+ ***************************************************/
+
+#ifndef POOL_H
+#define POOL_H
+
+typedef void (*pool_task_t)(void* arg, int task, int worker);
+
+/*
+    Number of online processors, at least 1.
+*/
+int poolThreads(void);
+
+/*
+    Runs fn(arg, task, worker) for every task in 0..tasks-1 on the given
+    number of workers (caller is worker 0) and returns when all are done.
+*/
+void poolRun(int threads, int tasks, pool_task_t fn, void* arg);
+
+#endif
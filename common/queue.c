@@ -0,0 +1,64 @@
+/***************************************************
+ * queue -- bounded blocking queue for passing     *
+ *          buffers between threads                *
+ ***************************************************/
+
+#include <stdlib.h>
+
+#include "common/queue.h"
+
+Queue* newQueue(int capacity){
+    Queue* q = (Queue*) malloc(sizeof(Queue));
+    q->items = (void**) malloc(capacity * sizeof(void*));
+    q->capacity = capacity;
+    q->head = 0;
+    q->size = 0;
+    q->closed = 0;
+    pthread_mutex_init(&q->lock, NULL);
+    pthread_cond_init(&q->notEmpty, NULL);
+    pthread_cond_init(&q->notFull, NULL);
+    return q;
+}
+
+void destroyQueue(Queue* q){
+    pthread_mutex_destroy(&q->lock);
+    pthread_cond_destroy(&q->notEmpty);
+    pthread_cond_destroy(&q->notFull);
+    free(q->items);
+    free(q);
+}
+
+void queuePush(Queue* q, void* item){
+    pthread_mutex_lock(&q->lock);
+    while (q->size == q->capacity && !q->closed)
+        pthread_cond_wait(&q->notFull, &q->lock);
+    if (!q->closed){
+        q->items[(q->head + q->size) % q->capacity] = item;
+        q->size++;
+        pthread_cond_signal(&q->notEmpty);
+    }
+    pthread_mutex_unlock(&q->lock);
+}
+
+void* queuePop(Queue* q){
+    void* item = NULL;
+    pthread_mutex_lock(&q->lock);
+    while (q->size == 0 && !q->closed)
+        pthread_cond_wait(&q->notEmpty, &q->lock);
+    if (q->size){
+        item = q->items[q->head];
+        q->head = (q->head + 1) % q->capacity;
+        q->size--;
+        pthread_cond_signal(&q->notFull);
+    }
+    pthread_mutex_unlock(&q->lock);
+    return item;
+}
+
+void queueClose(Queue* q){
+    pthread_mutex_lock(&q->lock);
+    q->closed = 1;
+    pthread_cond_broadcast(&q->notEmpty);
+    pthread_cond_broadcast(&q->notFull);
+    pthread_mutex_unlock(&q->lock);
+}
@@ -0,0 +1,40 @@
+/***************************************************
+ * queue -- bounded blocking queue for passing     *
+ *          buffers between threads                *
+ ***************************************************/
+
+#ifndef QUEUE_H
+#define QUEUE_H
+
+#include <pthread.h>
+
+typedef struct Queue {
+    void** items;
+    int capacity;
+    int head;
+    int size;
+    int closed;
+    pthread_mutex_t lock;
+    pthread_cond_t notEmpty;
+    pthread_cond_t notFull;
+} Queue;
+
+Queue* newQueue(int capacity);
+void destroyQueue(Queue* q);
+
+/*
+    Blocks while the queue is full.
+*/
+void queuePush(Queue* q, void* item);
+
+/*
+    Blocks while the queue is empty, returns NULL once it is closed and drained.
+*/
+void* queuePop(Queue* q);
+
+/*
+    No more items will be pushed, wakes up everyone waiting.
+*/
+void queueClose(Queue* q);
+
+#endif
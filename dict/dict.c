@@ -0,0 +1,253 @@
+/***************************************************
+ * dict -- trained dictionaries for compressing    *
+ *         many small messages                     *
+ ***************************************************/
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "dict/dict.h"
+
+static void put32(unsigned char* p, unsigned int x){
+    p[0] = x; p[1] = x >> 8; p[2] = x >> 16; p[3] = x >> 24;
+}
+
+static unsigned int get32(const unsigned char* p){
+    return p[0] | p[1] << 8 | p[2] << 16 | (unsigned int) p[3] << 24;
+}
+
+/*
+    Runs message through the primed LZW dictionary and either counts
+    its lzh symbols or writes them, then goes back to the primed state.
+*/
+static void messageCodes(DictEncoder* e, const unsigned char* src, size_t n, BitWriter* w, huff_freq_t* freqs){
+    const HuffEncoder* huff = &e->dict->encoder;
+    size_t i, k, count = 0;
+
+    for( i=0; i<n; i+=DICT_CHUNK ){
+        size_t chunk = n - i < DICT_CHUNK ? n - i : DICT_CHUNK;
+        count = lzwEncode(&e->lzw, src + i, chunk, e->codes);
+        if (i + chunk == n) count += lzwEncodeEnd(&e->lzw, e->codes + count);
+        if (freqs) for( k=0; k<count; k++ ) freqs[lzhSymbol(e->codes[k])]++;
+        else       for( k=0; k<count; k++ ) lzhPut(w, huff, e->codes[k]);
+        if (w && w->overflow) break;
+    }
+    lzwEncoderReset(&e->lzw);
+}
+
+static int buildTables(Dictionary* d){
+    huffBuildEncoder(&d->encoder, d->lengths, LZH_SYMBOLS);
+    return huffBuildDecoder(&d->decoder, d->lengths, LZH_SYMBOLS);
+}
+
+// sorts by descending score, score is above the 16 bits of the code
+static int byScore(const void* a, const void* b){
+    unsigned long long x = *(const unsigned long long*) a;
+    unsigned long long y = *(const unsigned long long*) b;
+    return x < y ? 1 : x > y ? -1 : 0;
+}
+
+/*
+    Phrases are picked by the bytes they covered while LZW ran over all
+    samples. A phrase needs all of its prefixes, so those are taken along,
+    and picked phrases keep their order, which keeps prefixes first.
+*/
+static void pickPhrases(Dictionary* d, int entries, const LzwEncoder* lzw, const unsigned int* used){
+    lzw_code_t* prefix = (lzw_code_t*) malloc(LZW_DICT_SIZE * sizeof(lzw_code_t));
+    unsigned char* symbol = (unsigned char*) malloc(LZW_DICT_SIZE);
+    unsigned int* length = (unsigned int*) malloc(LZW_DICT_SIZE * sizeof(unsigned int));
+    unsigned long long* order = (unsigned long long*) malloc(LZW_DICT_SIZE * sizeof(unsigned long long));
+    int* map = (int*) calloc(LZW_DICT_SIZE, sizeof(int));
+    int c, i, taken = 0, candidates = 0;
+
+    for( i=0; i<(1<<LZW_HASH_BITS); i++ ){
+        if (!lzw->keys[i]) continue;
+        c = lzw->values[i];
+        prefix[c] = (lzw->keys[i] - 1) >> 8;
+        symbol[c] = (lzw->keys[i] - 1) & 0xff;
+    }
+    for( c=LZW_R; c<lzw->count; c++ ){
+        length[c] = (prefix[c] < LZW_R ? 1 : length[prefix[c]]) + 1;
+        if (used[c]) order[candidates++] = (unsigned long long) used[c] * length[c] << 16 | c;
+    }
+    qsort(order, candidates, sizeof(unsigned long long), byScore);
+
+    // map[c] is 1 for picked phrases until they get their new codes
+    for( i=0; i<candidates && taken<entries; i++ ){
+        int need = 0;
+        for( c=order[i] & 0xffff; c>=LZW_R && !map[c]; c=prefix[c] ) need++;
+        if (taken + need > entries) continue;
+        for( c=order[i] & 0xffff; c>=LZW_R && !map[c]; c=prefix[c] ) map[c] = 1;
+        taken += need;
+    }
+
+    d->entries = 0;
+    for( c=LZW_R; c<lzw->count; c++ ){
+        if (!map[c]) continue;
+        int k = d->entries++;
+        d->prefix[k] = prefix[c] < LZW_R ? prefix[c] : map[prefix[c]];
+        d->symbol[k] = symbol[c];
+        map[c] = LZW_R + k;
+    }
+
+    free(map);
+    free(order);
+    free(length);
+    free(symbol);
+    free(prefix);
+}
+
+int dictTrain(Dictionary* d, unsigned int id, int entries, const unsigned char* const* samples, const size_t* sizes, int count){
+    if (entries < 0 || entries > DICT_MAX_ENTRIES || count < 1) return -1;
+
+    size_t longest = 0;
+    int i;
+    for( i=0; i<count; i++ ) if (sizes[i] > longest) longest = sizes[i];
+
+    LzwEncoder* lzw = (LzwEncoder*) malloc(sizeof(LzwEncoder));
+    lzw_code_t* codes = (lzw_code_t*) malloc((longest + 1) * sizeof(lzw_code_t));
+    unsigned int* used = (unsigned int*) calloc(LZW_DICT_SIZE, sizeof(unsigned int));
+    size_t k;
+
+    lzwEncoderInit(lzw);
+    for( i=0; i<count; i++ ){
+        size_t n = lzwEncode(lzw, samples[i], sizes[i], codes);
+        n += lzwEncodeEnd(lzw, codes + n);
+        for( k=0; k<n; k++ ) used[codes[k]]++;
+    }
+
+    d->id = id;
+    pickPhrases(d, entries, lzw, used);
+    free(used);
+    free(codes);
+    free(lzw);
+
+    // Huffman table comes from the symbols the primed coder produces,
+    // every symbol keeps a code so that any message can be coded
+    DictEncoder* e = (DictEncoder*) malloc(sizeof(DictEncoder));
+    huff_freq_t freqs[LZH_SYMBOLS];
+    for( i=0; i<LZH_SYMBOLS; i++ ) freqs[i] = 1;
+    dictEncoderInit(e, d);
+    for( i=0; i<count; i++ ) messageCodes(e, samples[i], sizes[i], NULL, freqs);
+    free(e);
+
+    huffLengths(freqs, LZH_SYMBOLS, HUFF_MAX_BITS, d->lengths);
+    return buildTables(d);
+}
+
+int dictSave(const Dictionary* d, FILE* out){
+    int i;
+    fwrite(DICT_MAGIC, 1, 4, out);
+    writeU32(out, d->id);
+    writeU32(out, d->entries);
+    for( i=0; i<d->entries; i++ ){
+        unsigned char b[3] = { d->prefix[i], d->prefix[i] >> 8, d->symbol[i] };
+        fwrite(b, 1, 3, out);
+    }
+    fwrite(d->lengths, 1, LZH_SYMBOLS, out);
+    return ferror(out) ? -1 : 0;
+}
+
+int dictLoad(Dictionary* d, FILE* in){
+    char magic[4];
+    unsigned int entries;
+    int i;
+
+    if (fread(magic, 1, 4, in) != 4 || memcmp(magic, DICT_MAGIC, 4)) return -1;
+    if (!readU32(in, &d->id) || !readU32(in, &entries) || entries > DICT_MAX_ENTRIES) return -1;
+    d->entries = entries;
+
+    for( i=0; i<d->entries; i++ ){
+        unsigned char b[3];
+        if (fread(b, 1, 3, in) != 3) return -1;
+        d->prefix[i] = b[0] | b[1] << 8;
+        d->symbol[i] = b[2];
+        if (d->prefix[i] >= LZW_R + i) return -1;
+    }
+
+    if (fread(d->lengths, 1, LZH_SYMBOLS, in) != LZH_SYMBOLS) return -1;
+    for( i=0; i<LZH_SYMBOLS; i++ )
+        if (!d->lengths[i] || d->lengths[i] > HUFF_MAX_BITS) return -1;
+    return buildTables(d);
+}
+
+int dictEncoderInit(DictEncoder* e, const Dictionary* d){
+    int i;
+    e->dict = d;
+    lzwEncoderInit(&e->lzw);
+    for( i=0; i<d->entries; i++ )
+        if (lzwEncoderAdd(&e->lzw, d->prefix[i], d->symbol[i]) != LZW_R + i) return -1;
+    lzwEncoderMark(&e->lzw, e->journal);
+    return 0;
+}
+
+void dictDecoderInit(DictDecoder* dec, const Dictionary* d){
+    int i;
+    dec->dict = d;
+    lzwDecoderInit(&dec->lzw);
+    for( i=0; i<d->entries; i++ ) lzwDecoderAdd(&dec->lzw, d->prefix[i], d->symbol[i]);
+    lzwDecoderMark(&dec->lzw);
+}
+
+size_t dictEncode(DictEncoder* e, const unsigned char* src, size_t n, unsigned char* dst){
+    BitWriter w;
+
+    put32(dst, e->dict->id);
+    put32(dst + 4, n);
+
+    // payload has to be smaller than the stored one
+    initBitWriter(&w, dst + DICT_HEADER, n);
+    messageCodes(e, src, n, &w, NULL);
+    size_t size = flushBits(&w);
+
+    if (w.overflow || size >= n){
+        dst[8] = DICT_STORED;
+        memcpy(dst + DICT_HEADER, src, n);
+        return n + DICT_HEADER;
+    }
+    dst[8] = DICT_CODED;
+    return size + DICT_HEADER;
+}
+
+int dictMessageInfo(const unsigned char* src, size_t size, unsigned int* id, size_t* n){
+    if (size < DICT_HEADER) return -1;
+    *id = get32(src);
+    *n = get32(src + 4);
+    return 0;
+}
+
+long dictDecode(DictDecoder* dec, const unsigned char* src, size_t size, unsigned char* dst, size_t capacity){
+    unsigned int id;
+    size_t n;
+
+    if (dictMessageInfo(src, size, &id, &n) || id != dec->dict->id || n > capacity) return -1;
+    int method = src[8];
+    src += DICT_HEADER;
+    size -= DICT_HEADER;
+
+    if (method == DICT_STORED){
+        if (size != n) return -1;
+        memcpy(dst, src, n);
+        return n;
+    }
+    if (method != DICT_CODED) return -1;
+
+    BitReader r;
+    size_t out = 0;
+    int error = 0;
+
+    initBitReader(&r, src, size);
+    while (out < n){
+        int code = lzhGet(&r, &dec->dict->decoder);
+        if (code < 0 || code >= LZW_DICT_SIZE) { error = 1; break; }
+
+        lzw_code_t c = code;
+        size_t used;
+        out += lzwDecode(&dec->lzw, &c, 1, &used, dst + out, n - out);
+        if (!used || dec->lzw.error) { error = 1; break; }
+    }
+    if (overrun(&r)) error = 1;
+
+    lzwDecoderReset(&dec->lzw);
+    return error ? -1 : (long) n;
+}
@@ -0,0 +1,106 @@
+/***************************************************
+ * dict -- trained dictionaries for compressing    *
+ *         many small messages                     *
+ *                                                 *
+ * A dictionary is a primed LZW dictionary plus a  *
+ * fixed Huffman table over lzh symbols, both      *
+ * trained on sample messages. Messages coded with *
+ * it carry no table, and the coders reset to the  *
+ * primed state between messages instead of being  *
+ * rebuilt.                                        *
+ *                                                 *
+ * File:     "DIC1" u32 id, u32 entries,           *
+ *           entries * (u16 prefix, u8 symbol),    *
+ *           LZH_SYMBOLS * u8 code length          *
+ * Message:  u32 id, u32 size, u8 method, payload  *
+ * All integers are little endian.                 *
+ ***************************************************/
+
+#ifndef DICT_H
+#define DICT_H
+
+#include <stdio.h>
+
+#include "huff/huffman.h"
+#include "lzh/lzh.h"
+#include "lzw/lzw.h"
+
+#define DICT_MAGIC "DIC1"
+#define DICT_HEADER 9
+#define DICT_STORED 0
+#define DICT_CODED  1
+
+// other half of the codes is left for phrases of the message itself
+#define DICT_MAX_ENTRIES (LZW_DICT_SIZE / 2)
+#define DICT_DEFAULT_ENTRIES (1<<14)
+
+#define DICT_CHUNK 4096
+
+typedef struct Dictionary {
+    unsigned int id;
+    int entries;                            // phrases above the 256 bytes
+    lzw_code_t prefix[DICT_MAX_ENTRIES];
+    unsigned char symbol[DICT_MAX_ENTRIES];
+    unsigned char lengths[LZH_SYMBOLS];
+    HuffEncoder encoder;
+    HuffDecoder decoder;
+} Dictionary;
+
+/*
+    Coder state, one per thread. Made once per dictionary, every
+    message only undoes what the previous one added.
+*/
+typedef struct DictEncoder {
+    const Dictionary* dict;
+    LzwEncoder lzw;
+    unsigned int journal[LZW_DICT_SIZE];
+    lzw_code_t codes[DICT_CHUNK];
+} DictEncoder;
+
+typedef struct DictDecoder {
+    const Dictionary* dict;
+    LzwDecoder lzw;
+} DictDecoder;
+
+/*
+    Encoded message is never bigger than this.
+*/
+static inline size_t dictBound(size_t n){
+    return n + DICT_HEADER;
+}
+
+/*
+    Trains dictionary with at most entries phrases on count sample messages.
+    Returns 0 or -1 on invalid arguments.
+*/
+int dictTrain(Dictionary* d, unsigned int id, int entries, const unsigned char* const* samples, const size_t* sizes, int count);
+
+int dictSave(const Dictionary* d, FILE* out);
+
+/*
+    Reads dictionary and builds its Huffman tables, returns 0 or -1 on invalid file.
+*/
+int dictLoad(Dictionary* d, FILE* in);
+
+int dictEncoderInit(DictEncoder* e, const Dictionary* d);
+void dictDecoderInit(DictDecoder* dec, const Dictionary* d);
+
+/*
+    Encodes message of n bytes into dst (at least dictBound(n) bytes),
+    returns encoded size.
+*/
+size_t dictEncode(DictEncoder* e, const unsigned char* src, size_t n, unsigned char* dst);
+
+/*
+    Reads id and size of the message from its header, returns -1 if it is too short.
+*/
+int dictMessageInfo(const unsigned char* src, size_t size, unsigned int* id, size_t* n);
+
+/*
+    Decodes message of size bytes into dst of capacity bytes.
+    Returns decoded size, or -1 on corrupted input, wrong dictionary
+    or too small dst.
+*/
+long dictDecode(DictDecoder* dec, const unsigned char* src, size_t size, unsigned char* dst, size_t capacity);
+
+#endif
@@ -0,0 +1,98 @@
+/***************************************************
+ * dictdekoder -- program to decode output of      *
+ *                dictkoder                        *
+ *                                                 *
+ * Usage:                                          *
+ *      dictdekoder -d dictionary [-d ...]         *
+ *                  input output                   *
+ *          - dictionary: dictionary file, every   *
+ *            message picks one by its id          *
+ *          - input: input file                    *
+ *          - output: output file                  *
+ ***************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include "common/iopipe.h"
+#include "dict/dict.h"
+
+#define MAX_DICTS 16
+#define CHUNK (1<<20)
+
+int main(int argc, char *argv[]){
+    Dictionary* dicts[MAX_DICTS];
+    DictDecoder* decoders[MAX_DICTS];
+    int count = 0, i;
+
+    int opt;
+    while( (opt = getopt(argc, argv, "d:")) != -1 ){
+        if (opt != 'd') return -1;
+        if (count == MAX_DICTS){
+            fprintf(stderr, "At most %d dictionaries\n", MAX_DICTS);
+            return -1;
+        }
+
+        FILE* f = fopen(optarg, "rb");
+        dicts[count] = (Dictionary*) malloc(sizeof(Dictionary));
+        if (!f || dictLoad(dicts[count], f)){
+            fprintf(stderr, "Can not load dictionary %s\n", optarg);
+            return -1;
+        }
+        fclose(f);
+        decoders[count] = (DictDecoder*) malloc(sizeof(DictDecoder));
+        dictDecoderInit(decoders[count], dicts[count]);
+        count++;
+    }
+    if (!count || argc - optind != 2){
+        fprintf(stderr, "Have to provide dictionary, input and output file.\nExample: %s -d dictionary_file [-d ...] input_file output_file\n", argv[0]);
+        return 0;
+    }
+
+    FILE* input  = fopen(argv[optind], "rb");
+    FILE* output = fopen(argv[optind+1], "wb");
+    if (!input || !output){
+        fprintf(stderr, "Can not open input or output file\n");
+        return -1;
+    }
+
+    unsigned char* encoded = (unsigned char*) malloc(dictBound(CHUNK));
+    unsigned char* message = (unsigned char*) malloc(CHUNK);
+
+    fprintf(stderr, "Decoding...\n");
+    fflush(output);
+    IoPipe* in = ioReader(fileno(input), IO_BUFFERS, IO_BUFFER_SIZE);
+    IoPipe* out = ioWriter(fileno(output), IO_BUFFERS, IO_BUFFER_SIZE);
+    unsigned int size;
+    int error = 0;
+    while (!error && ioGetU32(in, &size)){
+        unsigned int id;
+        size_t n;
+        long decoded = -1;
+
+        if (size > dictBound(CHUNK) || !ioGet(in, encoded, size)
+            || dictMessageInfo(encoded, size, &id, &n)){
+            error = 1;
+            break;
+        }
+        for( i=0; i<count; i++ )
+            if (dicts[i]->id == id) decoded = dictDecode(decoders[i], encoded, size, message, CHUNK);
+        if (decoded < 0) { error = 1; break; }
+        ioPut(out, message, decoded);
+    }
+    if (ioClose(in)) error = 1;
+    if (ioClose(out)) error = 1;
+    fprintf(stderr, error ? "Failed!\n" : "Done!\n");
+
+    fclose(input);
+    if (fclose(output)) error = -1;
+    for( i=0; i<count; i++ ){
+        free(decoders[i]);
+        free(dicts[i]);
+    }
+    free(message);
+    free(encoded);
+
+    return error ? -1 : 0;
+}
@@ -0,0 +1,91 @@
+/***************************************************
+ * dictkoder -- program to encode messages with a  *
+ *              dictionary made by dicttrain       *
+ *                                                 *
+ * Usage:                                          *
+ *      dictkoder -d dictionary [-s size]          *
+ *                input output                     *
+ *          - dictionary: dictionary file          *
+ *          - size: split input into messages of   *
+ *            size bytes, 1 MiB (the most) by      *
+ *            default                              *
+ *          - input: input file                    *
+ *          - output: output file                  *
+ *                                                 *
+ * Output is u32 size of the encoded message       *
+ * followed by the message, for every message.     *
+ ***************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include "common/iopipe.h"
+#include "dict/dict.h"
+
+#define CHUNK (1<<20)
+
+int main(int argc, char *argv[]){
+    const char* path = NULL;
+    long split = CHUNK;
+
+    int opt;
+    while( (opt = getopt(argc, argv, "d:s:")) != -1 ){
+        switch (opt) {
+            case 'd': path = optarg;          break;
+            case 's': split = atol(optarg);   break;
+            default: return -1;
+        }
+    }
+    if (!path || argc - optind != 2){
+        fprintf(stderr, "Have to provide dictionary, input and output file.\nExample: %s -d dictionary_file [-s message_size] input_file output_file\n", argv[0]);
+        return 0;
+    }
+    if (split < 1 || split > CHUNK){
+        fprintf(stderr, "Message size has to be between 1 and %d\n", CHUNK);
+        return -1;
+    }
+
+    FILE* dictionary = fopen(path, "rb");
+    FILE* input  = fopen(argv[optind], "rb");
+    FILE* output = fopen(argv[optind+1], "wb");
+    if (!dictionary || !input || !output){
+        fprintf(stderr, "Can not open dictionary, input or output file\n");
+        return -1;
+    }
+
+    // everything is set up once, messages only reuse it
+    Dictionary* d = (Dictionary*) malloc(sizeof(Dictionary));
+    DictEncoder* e = (DictEncoder*) malloc(sizeof(DictEncoder));
+    if (dictLoad(d, dictionary) || dictEncoderInit(e, d)){
+        fprintf(stderr, "Invalid dictionary %s\n", path);
+        return -1;
+    }
+    fclose(dictionary);
+
+    unsigned char* message = (unsigned char*) malloc(split);
+    unsigned char* encoded = (unsigned char*) malloc(dictBound(split));
+
+    fprintf(stderr, "Encoding...\n");
+    fflush(output);
+    IoPipe* in = ioReader(fileno(input), IO_BUFFERS, IO_BUFFER_SIZE);
+    IoPipe* out = ioWriter(fileno(output), IO_BUFFERS, IO_BUFFER_SIZE);
+    size_t n;
+    while( (n = ioGetSome(in, message, split)) > 0 ){
+        size_t size = dictEncode(e, message, n, encoded);
+        ioPutU32(out, size);
+        ioPut(out, encoded, size);
+    }
+    int error = ioClose(in);
+    if (ioClose(out)) error = -1;
+    fprintf(stderr, error ? "Failed!\n" : "Done!\n");
+
+    fclose(input);
+    if (fclose(output)) error = -1;
+    free(encoded);
+    free(message);
+    free(e);
+    free(d);
+
+    return error ? -1 : 0;
+}
@@ -0,0 +1,120 @@
+/***************************************************
+ * dicttrain -- program to train a dictionary for  *
+ *              dictkoder on sample messages       *
+ *                                                 *
+ * Usage:                                          *
+ *      dicttrain [-i id] [-e entries] [-s size]   *
+ *                dictionary samples...            *
+ *          - id: dictionary id, by default a hash *
+ *            of its content                       *
+ *          - entries: primed LZW phrases          *
+ *          - size: split samples into messages of *
+ *            size bytes, else a file is a message *
+ *          - dictionary: output file              *
+ *          - samples: sample files                *
+ ***************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include "dict/dict.h"
+
+static unsigned char* readFile(const char* path, size_t* size){
+    FILE* f = fopen(path, "rb");
+    if (!f) return NULL;
+    fseek(f, 0, SEEK_END);
+    long n = ftell(f);
+    fseek(f, 0, SEEK_SET);
+    unsigned char* data = (unsigned char*) malloc(n > 0 ? n : 1);
+    *size = fread(data, 1, n, f);
+    fclose(f);
+    return data;
+}
+
+// FNV-1a over phrases and code lengths
+static unsigned int contentId(const Dictionary* d){
+    unsigned int h = 2166136261u;
+    int i;
+    for( i=0; i<d->entries; i++ ){
+        h = (h ^ (d->prefix[i] & 0xff)) * 16777619u;
+        h = (h ^ (d->prefix[i] >> 8)) * 16777619u;
+        h = (h ^ d->symbol[i]) * 16777619u;
+    }
+    for( i=0; i<LZH_SYMBOLS; i++ ) h = (h ^ d->lengths[i]) * 16777619u;
+    return h;
+}
+
+int main(int argc, char *argv[]){
+    unsigned int id = 0;
+    int hasId = 0, entries = DICT_DEFAULT_ENTRIES;
+    long split = 0;
+
+    int opt;
+    while( (opt = getopt(argc, argv, "i:e:s:")) != -1 ){
+        switch (opt) {
+            case 'i': id = strtoul(optarg, NULL, 0); hasId = 1; break;
+            case 'e': entries = atoi(optarg);                  break;
+            case 's': split = atol(optarg);                    break;
+            default: return -1;
+        }
+    }
+    if (argc - optind < 2){
+        fprintf(stderr, "Have to provide dictionary and sample files.\nExample: %s [-i id] [-e entries] [-s message_size] dictionary_file sample_file...\n", argv[0]);
+        return 0;
+    }
+    if (entries < 0 || entries > DICT_MAX_ENTRIES || split < 0){
+        fprintf(stderr, "Invalid number of entries (at most %d) or message size\n", DICT_MAX_ENTRIES);
+        return -1;
+    }
+
+    int files = argc - optind - 1, count = 0, capacity = files, i;
+    const unsigned char** samples = (const unsigned char**) malloc(capacity * sizeof(unsigned char*));
+    size_t* sizes = (size_t*) malloc(capacity * sizeof(size_t));
+    unsigned char** data = (unsigned char**) malloc(files * sizeof(unsigned char*));
+
+    for( i=0; i<files; i++ ){
+        size_t size, offset = 0;
+        data[i] = readFile(argv[optind + 1 + i], &size);
+        if (!data[i]){
+            fprintf(stderr, "Can not open %s\n", argv[optind + 1 + i]);
+            return -1;
+        }
+        do {
+            size_t n = split && size - offset > (size_t) split ? (size_t) split : size - offset;
+            if (count == capacity){
+                capacity *= 2;
+                samples = (const unsigned char**) realloc(samples, capacity * sizeof(unsigned char*));
+                sizes = (size_t*) realloc(sizes, capacity * sizeof(size_t));
+            }
+            samples[count] = data[i] + offset;
+            sizes[count++] = n;
+            offset += n;
+        } while (offset < size);
+    }
+
+    FILE* output = fopen(argv[optind], "wb");
+    if (!output){
+        fprintf(stderr, "Can not open dictionary file\n");
+        return -1;
+    }
+
+    fprintf(stderr, "Training on %d messages...\n", count);
+    Dictionary* d = (Dictionary*) malloc(sizeof(Dictionary));
+    int error = dictTrain(d, id, entries, samples, sizes, count);
+    if (!error){
+        if (!hasId) d->id = contentId(d);
+        error = dictSave(d, output);
+        fprintf(stderr, "Dictionary %u with %d phrases\n", d->id, d->entries);
+    }
+    fprintf(stderr, error ? "Failed!\n" : "Done!\n");
+
+    if (fclose(output)) error = -1;
+    for( i=0; i<files; i++ ) free(data[i]);
+    free(data);
+    free(sizes);
+    free(samples);
+    free(d);
+
+    return error ? -1 : 0;
+}
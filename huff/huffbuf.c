@@ -0,0 +1,78 @@
+/***************************************************
+ * huffbuf -- Huffman coding from buffer to buffer *
+ *            without allocating                   *
+ ***************************************************/
+
+#include <string.h>
+
+#include "huff/huffbuf.h"
+
+#define R 256
+#define LENGTH_BITS 4
+#define RUN_BITS 8
+
+static void put32(unsigned char* p, unsigned int x){
+    p[0] = x; p[1] = x >> 8; p[2] = x >> 16; p[3] = x >> 24;
+}
+
+static unsigned int get32(const unsigned char* p){
+    return p[0] | p[1] << 8 | p[2] << 16 | (unsigned int) p[3] << 24;
+}
+
+static size_t stored(const unsigned char* src, size_t n, unsigned char* dst){
+    dst[0] = HUFF_BUF_STORED;
+    put32(dst + 1, n);
+    memcpy(dst + HUFF_BUF_HEADER, src, n);
+    return n + HUFF_BUF_HEADER;
+}
+
+size_t huffCompress(HuffWorkspace* w, const unsigned char* src, size_t n, unsigned char* dst, size_t capacity){
+    if (capacity < huffCompressBound(n) || n > HUFF_BUF_MAX) return 0;
+
+    BitWriter bw;
+
+    huffHistogram(src, n, w->freqs);
+    huffLengthsWith(w->freqs, R, HUFF_MAX_BITS, w->lengths, w->scratch);
+    huffBuildEncoder(&w->encoder, w->lengths, R);
+    int paired = huffBuildPairEncoder(&w->pairEncoder, &w->encoder, n);
+
+    // payload has to be smaller than the stored one
+    initBitWriter(&bw, dst + HUFF_BUF_HEADER, n);
+    // small messages use few byte values
+    huffWriteLengthRuns(&bw, w->lengths, R, LENGTH_BITS, RUN_BITS);
+    huffPutBytes(&bw, &w->encoder, paired ? &w->pairEncoder : NULL, src, n);
+    size_t size = flushBits(&bw);
+
+    if (bw.overflow || size >= n) return stored(src, n, dst);
+    dst[0] = HUFF_BUF_CODED;
+    put32(dst + 1, n);
+    return size + HUFF_BUF_HEADER;
+}
+
+long long huffDecompressedSize(const unsigned char* src, size_t size){
+    if (size < HUFF_BUF_HEADER) return -1;
+    return get32(src + 1);
+}
+
+long long huffDecompress(HuffWorkspace* w, const unsigned char* src, size_t size, unsigned char* dst, size_t capacity){
+    long long n = huffDecompressedSize(src, size);
+    if (n < 0 || (size_t) n > capacity) return -1;
+    int method = src[0];
+    src += HUFF_BUF_HEADER;
+    size -= HUFF_BUF_HEADER;
+
+    if (method == HUFF_BUF_STORED){
+        if (size != (size_t) n) return -1;
+        memcpy(dst, src, n);
+        return n;
+    }
+    if (method != HUFF_BUF_CODED) return -1;
+
+    BitReader br;
+
+    initBitReader(&br, src, size);
+    if (huffReadLengthRuns(&br, w->lengths, R, LENGTH_BITS, RUN_BITS) || huffBuildDecoder(&w->decoder, w->lengths, R)) return -1;
+    int paired = huffBuildPairDecoder(&w->pairDecoder, &w->decoder, n);
+    if (huffGetBytes(&br, &w->decoder, paired ? &w->pairDecoder : NULL, dst, n)) return -1;
+    return overrun(&br) ? -1 : n;
+}
@@ -0,0 +1,65 @@
+/***************************************************
+ * huffbuf -- Huffman coding from buffer to buffer *
+ *            without allocating                   *
+ *                                                 *
+ * For callers that code many small messages in    *
+ * process (an RPC server): every table lives in a *
+ * workspace the caller owns and reuses, one per   *
+ * thread, so a call touches no heap.              *
+ *                                                 *
+ * Message:  u8 method, u32 size, payload          *
+ * Payload:  code lengths, 4 bits each, a zero is  *
+ *           followed by 8 bits of further zeros,  *
+ *           then the codes; or the bytes as they  *
+ *           are when that is not smaller.         *
+ ***************************************************/
+
+#ifndef HUFFBUF_H
+#define HUFFBUF_H
+
+#include <stddef.h>
+
+#include "huff/huffman.h"
+
+#define HUFF_BUF_HEADER 5
+#define HUFF_BUF_STORED 0
+#define HUFF_BUF_CODED  1
+
+// messages keep their size in 32 bits
+#define HUFF_BUF_MAX 0xFFFFFFFFu
+
+typedef struct HuffWorkspace {
+    huff_freq_t freqs[256];
+    unsigned char lengths[256];
+    HuffEncoder encoder;
+    HuffDecoder decoder;
+    HuffPairEncoder pairEncoder;
+    HuffPairDecoder pairDecoder;
+    unsigned long long scratch[HUFF_SCRATCH(256) / sizeof(unsigned long long)];
+} HuffWorkspace;
+
+/*
+    Compressed n bytes are never bigger than this.
+*/
+static inline size_t huffCompressBound(size_t n){
+    return n + HUFF_BUF_HEADER;
+}
+
+/*
+    Compresses n bytes into dst of capacity bytes, returns compressed size,
+    or 0 if capacity is below huffCompressBound(n) or n above HUFF_BUF_MAX.
+*/
+size_t huffCompress(HuffWorkspace* w, const unsigned char* src, size_t n, unsigned char* dst, size_t capacity);
+
+/*
+    Size of the message once decompressed, -1 if it is too short.
+*/
+long long huffDecompressedSize(const unsigned char* src, size_t size);
+
+/*
+    Decompresses message of size bytes into dst of capacity bytes.
+    Returns decompressed size, or -1 on corrupted input or too small dst.
+*/
+long long huffDecompress(HuffWorkspace* w, const unsigned char* src, size_t size, unsigned char* dst, size_t capacity);
+
+#endif
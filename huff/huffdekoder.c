@@ -17,8 +17,14 @@
 #include <stdlib.h>
 #include <string.h>
 
+#include "common/iopipe.h"
+
 #define R 256
-#define BUFF 1<<4
+#define BUFF IO_BUFFER_SIZE
+
+// bits peeked at once, codes of up to two symbols that end within them
+// are decoded by one lookup
+#define PEEK_BITS 12
 
 typedef unsigned char huff_t;
 
@@ -29,26 +35,48 @@ typedef struct node_t {
 } Node;
 
 typedef struct BinIn {
-    FILE* in;
-    int idx;
-    huff_t buffer;
+    IoPipe* in;
+    unsigned long long acc;  // next bit highest
+    int bits;
+    int padding;       // zero bits added past the end of input
+    size_t pos;        // next byte of chunk
+    size_t size;       // bytes in chunk
+    const huff_t* chunk;
 } BinIn;
 
-BinIn* newBinIn(FILE* in){
+BinIn* newBinIn(IoPipe* in){
     BinIn* b = (BinIn*) malloc(sizeof(BinIn));
     b->in = in;
-    b->idx = 0;
-    b->buffer = 0;
+    b->acc = 0;
+    b->bits = 0;
+    b->padding = 0;
+    b->pos = 0;
+    b->size = 0;
     return b;
 }
 
-int readBit(BinIn* b){
-    int s = sizeof(b->buffer);
-    if (b->idx == 0)
-        if (!fread(&(b->buffer), s, 1, b->in)) return -1;
-    int bit = ((1<<(8*s-1-b->idx)) & b->buffer) != 0;
-    b->idx = (b->idx + 1) % (8*s);
-    return bit;
+void refill(BinIn* b){
+    while (b->bits <= 56){
+        if (b->pos == b->size && !b->padding){
+            if (!(b->chunk = ioRead(b->in, &b->size))) b->size = 0;
+            b->pos = 0;
+        }
+        unsigned long long byte = 0;
+        if (b->pos < b->size) byte = b->chunk[b->pos++];
+        else                  b->padding += 8;
+        b->acc |= byte << (56 - b->bits);
+        b->bits += 8;
+    }
+}
+
+void skipBits(BinIn* b, int n){
+    b->acc <<= n;
+    b->bits -= n;
+}
+
+// true when decoded bits reach into the padding
+int pastEnd(BinIn* b){
+    return b->bits < b->padding;
 }
 
 Node* newNode(huff_t data){
@@ -78,24 +106,102 @@ Node* buildTrie(FILE* table){
     return root;
 }
 
-void decompress(FILE* input, FILE* output, Node* trie){
+/*
+    Number of symbols, 8 bytes little endian.
+*/
+unsigned long long readSize(IoPipe* in){
+    huff_t b[8];
+    unsigned long long size = 0;
+    int i;
+    if (!ioGet(in, b, 8)) return 0;
+    for( i=7; i>=0; i-- ) size = size << 8 | b[i];
+    return size;
+}
 
-    long int size;
-    fread(&size, sizeof(size), 1, input);
+/*
+    Walks the trie on every PEEK_BITS bits once, an entry holds the symbols
+    whose codes end within them: first | second<<8 | length of first<<16 |
+    length of both<<20 | count<<24. Count 0 means the first code is longer.
+*/
+unsigned int* buildTable(Node* trie){
+    unsigned int* table = (unsigned int*) malloc((1<<PEEK_BITS) * sizeof(unsigned int));
+    unsigned int bits;
+    for( bits=0; bits<(1u<<PEEK_BITS); bits++ ){
+        unsigned int symbols[2], ends[2];
+        int count = 0, k;
+        Node* curr = trie;
+        for( k=1; k<=PEEK_BITS && count<2 && curr; k++ ){
+            curr = bits >> (PEEK_BITS - k) & 1 ? curr->right : curr->left;
+            if (curr && !curr->left && !curr->right){
+                symbols[count] = curr->data;
+                ends[count++] = k;
+                curr = trie;
+            }
+        }
+        table[bits] = 0;
+        if (count == 1) table[bits] = symbols[0] | ends[0] << 16 | ends[0] << 20 | 1u << 24;
+        if (count == 2) table[bits] = symbols[0] | symbols[1] << 8 | ends[0] << 16 | ends[1] << 20 | 2u << 24;
+    }
+    return table;
+}
 
-    BinIn* b = newBinIn(input);
+/*
+    Long codes, one bit at a time. Returns the symbol or -1.
+*/
+int decodeLong(BinIn* b, Node* trie){
     Node* curr = trie;
+    while (curr && (curr->left || curr->right)){
+        if (!b->bits) refill(b);
+        curr = b->acc >> 63 ? curr->right : curr->left;
+        skipBits(b, 1);
+    }
+    return curr && !pastEnd(b) ? curr->data : -1;
+}
+
+/*
+    Input and output go through buffers that are filled and drained in the
+    background, memory does not depend on size. Returns 0 or -1 if reading
+    or writing failed.
+*/
+int decompress(FILE* input, FILE* output, Node* trie){
+    fflush(output);
+    IoPipe* in = ioReader(fileno(input), IO_BUFFERS, BUFF);
+    IoPipe* o = ioWriter(fileno(output), IO_BUFFERS, BUFF);
+    unsigned long long size = readSize(in);
+    huff_t* out = ioBuffer(o);
+    unsigned int* table = buildTable(trie);
+    size_t n = 0;
+
+    BinIn* b = newBinIn(in);
     while(size){
-        int bit = readBit(b);
-        if (bit) curr = curr->right;
-        else     curr = curr->left;
-        if (!curr) break;
-        if (!curr->left && !curr->right){
-            fwrite(&(curr->data), sizeof(curr->data), 1, output);
-            curr = trie;
-            size--;
+        if (b->bits < PEEK_BITS) refill(b);
+        unsigned int entry = table[b->acc >> (64 - PEEK_BITS)];
+        int count = entry >> 24;
+        if (count == 2 && size >= 2){
+            skipBits(b, entry >> 20 & 0xF);
+            if (pastEnd(b)) break;
+            out[n++] = entry;
+            out[n++] = entry >> 8;
+        } else if (count){
+            skipBits(b, entry >> 16 & 0xF);
+            if (pastEnd(b)) break;
+            out[n++] = entry;
+        } else {
+            int symbol = decodeLong(b, trie);
+            if (symbol < 0) break;
+            out[n++] = symbol;
         }
+        size -= count == 2 && size >= 2 ? 2 : 1;
+        // room for a pair before the next check
+        if (n >= BUFF - 1) { ioWrite(o, n); out = ioBuffer(o); n = 0; }
     }
+    ioWrite(o, n);
+
+    int error = ioClose(in);
+    if (ioClose(o)) error = -1;
+    free(table);
+    free(b);
+    return error;
 }
 
 int main(int argc, char *argv[]){
@@ -110,12 +216,12 @@ int main(int argc, char *argv[]){
 
     fprintf(stderr, "Decompressing...\n");
     Node* trie = buildTrie(table);
-    decompress(input, output, trie);
-    fprintf(stderr, "Done!\n");
+    int error = decompress(input, output, trie);
+    fprintf(stderr, error ? "Failed!\n" : "Done!\n");
 
     fclose(input);
     fclose(table);
     fclose(output);
 
-    return 0;
+    return error ? -1 : 0;
 }
@@ -0,0 +1,140 @@
+/***************************************************
+ * huffkernel -- Huffman coding of a block of      *
+ *               fixed width symbols, included     *
+ *               once per instantiation            *
+ *                                                 *
+ * Parameters, undefined again at the end:         *
+ *   HK_BITS         symbol width, 8 or 16         *
+ *   HK_SYMBOL       symbol type                   *
+ *   HK_MAX_BITS     longest code                  *
+ *   HK_LOOKUP_BITS  bits of the decoding table    *
+ *   HK_BLOCK        also generate the one-shot    *
+ *                   block kernel                  *
+ *                                                 *
+ * Generates huffPutSymbols<bits> and              *
+ * huffGetSymbols<bits>, the symbol loops with     *
+ * alphabet size and code widths known to the      *
+ * compiler; huffman.c codes bytes with the 8 bit  *
+ * ones. With HK_BLOCK also HuffKernel<bits> (the  *
+ * workspace), huffKernelEncode<bits> and          *
+ * huffKernelDecode<bits>. Tables are built by the *
+ * shared builders of huffman.c.                   *
+ *                                                 *
+ * Block: code lengths, 5 bits each, a zero is     *
+ *        followed by HK_BITS bits of further      *
+ *        zeros, then the codes. Same bit packing  *
+ *        as huff/huffman.h.                       *
+ ***************************************************/
+
+#define HK_CAT(a, b) a##b
+#define HK_NAME(name, bits) HK_CAT(name, bits)
+#define HK(name) HK_NAME(name, HK_BITS)
+
+#define HK_R (1 << HK_BITS)
+#define HK_LENGTH_BITS 5
+
+/*
+    Codes n symbols, codes are bit-reversed as huffBuildCodes makes them.
+*/
+static inline void HK(huffPutSymbols)(BitWriter* w, const unsigned int* codes, const unsigned char* lengths, const HK_SYMBOL* src, size_t n){
+    BitWriter b = *w;
+    size_t i;
+    for( i=0; i<n && !b.overflow; i++ ) putBits(&b, codes[src[i]], lengths[src[i]]);
+    *w = b;
+}
+
+/*
+    Decodes exactly n symbols with the table, count and sorted of
+    huffBuildTable, returns 0 or -1 on invalid input.
+*/
+static inline int HK(huffGetSymbols)(BitReader* r, const unsigned int* table, const unsigned int* count, const unsigned short* sorted, HK_SYMBOL* dst, size_t n){
+    BitReader b = *r;
+    size_t i;
+    int error = 0;
+
+    for( i=0; i<n; i++ ){
+        if (b.bits < HK_MAX_BITS) refill(&b);
+        unsigned int entry = table[b.acc & ((1<<HK_LOOKUP_BITS) - 1)];
+        if (entry) {
+            b.acc >>= entry & HUFF_ENTRY_MASK;
+            b.bits -= entry & HUFF_ENTRY_MASK;
+            dst[i] = entry >> HUFF_ENTRY_BITS;
+            continue;
+        }
+        int symbol = huffGetSlowWith(&b, count, sorted, HK_MAX_BITS);
+        if (symbol < 0) { error = -1; break; }
+        dst[i] = symbol;
+    }
+    *r = b;
+    return error;
+}
+
+#ifdef HK_BLOCK
+
+typedef struct HK(HuffKernel) {
+    huff_freq_t freqs[HK_R];
+    unsigned char lengths[HK_R];
+    unsigned int codes[HK_R];                   // bit-reversed
+    unsigned int table[1<<HK_LOOKUP_BITS];      // huffman.h table entries, 0 for long codes
+    unsigned int count[HK_MAX_BITS+1];
+    unsigned short sorted[HK_R];
+    unsigned long long scratch[HUFF_SCRATCH(HK_R) / sizeof(unsigned long long)];
+} HK(HuffKernel);
+
+static void HK(histogram)(HK(HuffKernel)* k, const HK_SYMBOL* src, size_t n){
+#if HK_BITS == 8
+    huffHistogram(src, n, k->freqs);
+#else
+    size_t i;
+    memset(k->freqs, 0, sizeof(k->freqs));
+    for( i=0; i<n; i++ ) k->freqs[src[i]]++;
+#endif
+}
+
+/*
+    Encodes n symbols into dst, returns encoded size or 0 if it does not fit.
+    Work is a HuffKernel of this width.
+*/
+static size_t HK(huffKernelEncode)(void* work, const void* symbols, size_t n, unsigned char* dst, size_t capacity){
+    HK(HuffKernel)* k = (HK(HuffKernel)*) work;
+    const HK_SYMBOL* src = (const HK_SYMBOL*) symbols;
+    BitWriter w;
+
+    HK(histogram)(k, src, n);
+    huffLengthsWith(k->freqs, HK_R, HK_MAX_BITS, k->lengths, k->scratch);
+    huffBuildCodes(k->lengths, HK_R, HK_MAX_BITS, k->codes);
+
+    initBitWriter(&w, dst, capacity);
+    huffWriteLengthRuns(&w, k->lengths, HK_R, HK_LENGTH_BITS, HK_BITS);
+    HK(huffPutSymbols)(&w, k->codes, k->lengths, src, n);
+    size_t size = flushBits(&w);
+    return w.overflow ? 0 : size;
+}
+
+/*
+    Decodes exactly n symbols, returns 0 or -1 on corrupted input.
+*/
+static int HK(huffKernelDecode)(void* work, const unsigned char* src, size_t size, void* symbols, size_t n){
+    HK(HuffKernel)* k = (HK(HuffKernel)*) work;
+    HK_SYMBOL* dst = (HK_SYMBOL*) symbols;
+    BitReader r;
+
+    initBitReader(&r, src, size);
+    if (huffReadLengthRuns(&r, k->lengths, HK_R, HK_LENGTH_BITS, HK_BITS)
+        || huffBuildTable(k->lengths, HK_R, HK_MAX_BITS, HK_LOOKUP_BITS, k->table, k->count, k->sorted)) return -1;
+    if (HK(huffGetSymbols)(&r, k->table, k->count, k->sorted, dst, n)) return -1;
+    return overrun(&r) ? -1 : 0;
+}
+
+#undef HK_BLOCK
+#endif
+
+#undef HK_CAT
+#undef HK_NAME
+#undef HK
+#undef HK_R
+#undef HK_LENGTH_BITS
+#undef HK_BITS
+#undef HK_SYMBOL
+#undef HK_MAX_BITS
+#undef HK_LOOKUP_BITS
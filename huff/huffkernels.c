@@ -0,0 +1,46 @@
+/***************************************************
+ * huffkernels -- Huffman kernels for 8 and 16 bit *
+ *                symbols, picked at run time      *
+ ***************************************************/
+
+#include <string.h>
+
+#include "huff/huffkernels.h"
+#include "huff/huffman.h"
+
+// bytes: same limits as huffman.c
+#define HK_BITS 8
+#define HK_SYMBOL unsigned char
+#define HK_MAX_BITS HUFF_MAX_BITS
+#define HK_LOOKUP_BITS HUFF_LOOKUP_BITS
+#define HK_BLOCK
+#include "huff/huffkernel.h"
+
+// 65536 symbols need codes past 16 bits
+#define HK_BITS 16
+#define HK_SYMBOL unsigned short
+#define HK_MAX_BITS 20
+#define HK_LOOKUP_BITS 12
+#define HK_BLOCK
+#include "huff/huffkernel.h"
+
+static const HuffKernelOps kernels[] = {
+    { 8,  HUFF_MAX_BITS, sizeof(HuffKernel8),  huffKernelEncode8,  huffKernelDecode8 },
+    { 16, 20,            sizeof(HuffKernel16), huffKernelEncode16, huffKernelDecode16 },
+};
+
+const HuffKernelOps* huffKernel(int bits){
+    size_t i;
+    for( i=0; i<sizeof(kernels)/sizeof(kernels[0]); i++ )
+        if (kernels[i].bits == bits) return &kernels[i];
+    return NULL;
+}
+
+/*
+    Lengths take at most 5 + bits bits per symbol, putBits may
+    give up with 3 bytes still free.
+*/
+size_t huffKernelBound(const HuffKernelOps* k, size_t n){
+    size_t header = ((size_t) 1 << k->bits) * (5 + k->bits);
+    return (header + n * k->maxBits + 7) / 8 + 4;
+}
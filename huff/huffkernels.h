@@ -0,0 +1,43 @@
+/***************************************************
+ * huffkernels -- Huffman kernels for 8 and 16 bit *
+ *                symbols, picked at run time      *
+ *                                                 *
+ * Every width is its own instantiation of         *
+ * huff/huffkernel.h, so the hot loops know the    *
+ * alphabet and the code widths at compile time.   *
+ * 16 bit symbols (samples, UTF-16) keep their     *
+ * structure that byte coding splits apart.        *
+ ***************************************************/
+
+#ifndef HUFFKERNELS_H
+#define HUFFKERNELS_H
+
+#include <stddef.h>
+
+typedef struct HuffKernelOps {
+    int bits;               // symbol width
+    int maxBits;            // longest code
+    size_t workspace;       // bytes of workspace, owned by the caller
+
+    /*
+        Encodes n symbols, returns encoded size or 0 if it does not fit.
+    */
+    size_t (*encode)(void* work, const void* src, size_t n, unsigned char* dst, size_t capacity);
+
+    /*
+        Decodes exactly n symbols, returns 0 or -1 on corrupted input.
+    */
+    int (*decode)(void* work, const unsigned char* src, size_t size, void* dst, size_t n);
+} HuffKernelOps;
+
+/*
+    Kernel for symbols of the given width, NULL if there is none.
+*/
+const HuffKernelOps* huffKernel(int bits);
+
+/*
+    Encoded n symbols are never bigger than this.
+*/
+size_t huffKernelBound(const HuffKernelOps* k, size_t n);
+
+#endif
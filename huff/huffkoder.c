@@ -7,21 +7,69 @@
  * Purpose:  TINF lab 2015/2016                    *
  *                                                 *
  * Usage:                                          *
- *      huffkoder input table output               *
+ *      huffkoder [--stats] input table output     *
  *          - input: input file                    *
  *          - table: huffman table output file     *
  *          - output: output file                  *
+ *          - --stats: print JSON report to stdout *
+ *                     (needs build with -DSTATS)  *
  ***************************************************/
 
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 
+#include "common/iopipe.h"
+
 #define R 256
-#define BUFF 1<<4
+#define BUFF IO_BUFFER_SIZE
 
 typedef unsigned char huff_t;
-typedef unsigned int huff_freq_t;
+typedef unsigned long long huff_freq_t;
+
+// counts are scaled down to this many bits before the tree is built
+#define FREQ_BITS 32
+
+// two codes go out in one append when together they are this short
+#define PAIR_BITS 27
+
+/*
+    Hot path counters, only compiled in with -DSTATS.
+    Everything inside STAT(...) disappears from a normal build.
+*/
+#ifdef STATS
+#include <time.h>
+
+#define STAT(...) __VA_ARGS__
+
+typedef struct Stats {
+    double histogram;   // seconds spent in each phase
+    double tree;
+    double encode;
+    double io;
+    unsigned long long symbols;
+    unsigned long long bits;
+    int maxDepth;
+} Stats;
+
+static Stats stats;
+
+static double now(){
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void printStats(FILE* out){
+    fprintf(out, "{\"codec\": \"huff\", \"histogram_s\": %.6f, \"tree_s\": %.6f, "
+                 "\"encode_s\": %.6f, \"io_s\": %.6f, \"symbols\": %llu, \"bits\": %llu, "
+                 "\"avg_code_length\": %.4f, \"max_code_depth\": %d}\n",
+        stats.histogram, stats.tree, stats.encode, stats.io, stats.symbols, stats.bits,
+        stats.symbols ? stats.bits / (double) stats.symbols : 0, stats.maxDepth);
+}
+#else
+#define STAT(...)
+#endif
 
 typedef struct node_t {
     huff_t data; // only leafs
@@ -37,34 +85,68 @@ typedef struct minpq_t {
 } MinPQ;
 
 typedef struct BinOut {
-    FILE* out;
-    int idx;
-    huff_t buffer;
+    IoPipe* out;
+    unsigned long long acc;  // bits not yet written, last one lowest
+    int bits;                // at most 7 between appends
+    int size;          // bytes waiting in chunk
+    huff_t* chunk;     // output buffer being filled
 } BinOut;
 
-void write(BinOut* b, char* code){
-    int s = sizeof(b->buffer);
-    for( ; *code; code++ ){
-        b->buffer *= 2;
-        b->buffer += *code=='1';
+/*
+    Codes as numbers, first bit highest, and the codes of every pair of
+    bytes put together (first<<8 | second), code<<5 | length or 0 if the
+    pair is longer than PAIR_BITS.
+*/
+typedef struct Codebook {
+    unsigned long long code[R];
+    int length[R];
+    unsigned int pairs[R*R];
+} Codebook;
+
+/*
+    Reading and writing run on their own (see iopipe), io time is only
+    the time spent waiting for them.
+*/
+const huff_t* readChunk(IoPipe* in, size_t* n){
+    STAT(double start = now());
+    const huff_t* chunk = ioRead(in, n);
+    STAT(stats.io += now() - start);
+    return chunk;
+}
 
-        if (++b->idx == 8 * s){
-            b->idx = 0;
-            fwrite(&(b->buffer), s, 1, b->out);
-            b->buffer = 0;
-        }
+void writeChunk(BinOut* b){
+    STAT(double start = now());
+    ioWrite(b->out, b->size);
+    b->chunk = ioBuffer(b->out);
+    STAT(stats.io += now() - start);
+    b->size = 0;
+}
+
+/*
+    Appends up to 32 bits, the 7 still waiting leave room for them.
+*/
+void putBits(BinOut* b, unsigned long long value, int n){
+    b->acc = b->acc << n | value;
+    b->bits += n;
+    while (b->bits >= 8){
+        b->bits -= 8;
+        b->chunk[b->size++] = b->acc >> b->bits;
+        if (b->size == BUFF) writeChunk(b);
     }
 }
 
+void putCode(BinOut* b, const Codebook* book, huff_t symbol){
+    int len = book->length[symbol];
+    if (len > 32) putBits(b, book->code[symbol] >> 32, len - 32);
+    putBits(b, book->code[symbol] & 0xFFFFFFFF, len < 32 ? len : 32);
+}
+
 void flush(BinOut* b){
-    if (!b->idx) return;
-    int s = sizeof(b->buffer);
-    while(b->idx){
-        b->buffer *= 2;
-        b->idx = (b->idx + 1) % (8*s);
+    if (b->bits){
+        b->chunk[b->size++] = b->acc << (8 - b->bits);
+        b->bits = 0;
     }
-    fwrite(&(b->buffer), s, 1, b->out);
-    b->buffer = 0;
+    writeChunk(b);
 }
 
 Node* newNode(huff_t data, huff_freq_t freq){
@@ -79,6 +161,7 @@ Node* newNode(huff_t data, huff_freq_t freq){
 Node* merge(Node* left, Node* right){
     Node* parent  = (Node*) malloc (sizeof(Node));
     parent->data  = 0;
+    parent->freq  = left->freq + right->freq;
     parent->left  = left;
     parent->right = right;
     return parent;
@@ -127,7 +210,7 @@ void insert(MinPQ* pq, Node* node){
     int idx = pq->size++;
     pq->array[idx] = node;
     while (idx) {
-        huff_t parent = idx / 2;
+        int parent = (idx - 1) / 2;
         if (!less(pq, idx, parent)) break;
         exch(pq, idx, parent);
         idx = parent;
@@ -178,45 +261,138 @@ void createCodes(Node* node, char* tmp, int level, char* codes[R]){
 
 }
 
+/*
+    Depth of the tree grows with the logarithm of the total count (at worst
+    as Fibonacci numbers), so counts past FREQ_BITS are shifted down to keep
+    codes short. Symbols that occur keep a count of at least 1.
+*/
+void rescale(huff_freq_t* freqs){
+    huff_freq_t max = 0;
+    int i, shift = 0;
+    for( i=0; i<R; i++ ) if (freqs[i] > max) max = freqs[i];
+    while (max >> shift >> FREQ_BITS) shift++;
+    if (!shift) return;
+
+    for( i=0; i<R; i++ )
+        if (freqs[i]) freqs[i] = freqs[i] >> shift ? freqs[i] >> shift : 1;
+}
+
+Codebook* createCodebook(char* codes[R]){
+    Codebook* book = (Codebook*) malloc(sizeof(Codebook));
+    int i, j;
+    for( i=0; i<R; i++ ){
+        char* c;
+        book->code[i] = 0;
+        for( c=codes[i]; *c; c++ ) book->code[i] = book->code[i] * 2 + (*c=='1');
+        book->length[i] = strlen(codes[i]);
+    }
+    for( i=0; i<R; i++ )
+        for( j=0; j<R; j++ ){
+            // long pairs are left out before shifting, codes go up to 255 bits
+            int len = book->length[i] + book->length[j];
+            if (len > PAIR_BITS) { book->pairs[i << 8 | j] = 0; continue; }
+            unsigned int code = book->code[i] << book->length[j] | book->code[j];
+            book->pairs[i << 8 | j] = code << 5 | len;
+        }
+    return book;
+}
+
 huff_freq_t* findFrequencies(FILE* in){
     huff_freq_t* freqs = (huff_freq_t*) malloc(R * sizeof(huff_freq_t));
-    int i;
+    size_t i;
     for( i=0; i<R; i++ ) freqs[i] = 0;
 
-    huff_t symbol;
-    while( fread(&symbol, sizeof(symbol), 1, in) )
-        freqs[symbol]++;
+    STAT(double start = now(), io = stats.io);
+    IoPipe* pipe = ioReader(fileno(in), IO_BUFFERS, BUFF);
+    const huff_t* chunk;
+    size_t n;
+    while( (chunk = readChunk(pipe, &n)) )
+        for( i=0; i<n; i++ ) freqs[chunk[i]]++;
+    ioClose(pipe);
+    STAT(stats.histogram += now() - start - (stats.io - io));
 
     return freqs;
 }
 
 void compress(FILE* input, FILE* output, char* codes[R]){
-    huff_t symbol;
+    STAT(double start = now(), io = stats.io);
+    const huff_t* chunk;
+    size_t n, i;
+    fflush(output);
+    IoPipe* in = ioReader(fileno(input), IO_BUFFERS, BUFF);
     BinOut* b = (BinOut*) malloc(sizeof(BinOut));
-    b->out = output;
-    b->idx = 0;
-    while(fread(&symbol, sizeof(huff_t), 1, input))
-        write(b, codes[symbol]);
+    b->out = ioWriter(fileno(output), IO_BUFFERS, BUFF);
+    b->chunk = ioBuffer(b->out);
+    b->acc = 0;
+    b->bits = 0;
+    b->size = 0;
+    Codebook* book = createCodebook(codes);
+    while( (chunk = readChunk(in, &n)) ){
+        // byte pairs take one lookup and one append
+        for( i=0; i+2<=n; i+=2 ){
+            unsigned int pair = book->pairs[chunk[i] << 8 | chunk[i+1]];
+            if (pair) putBits(b, pair >> 5, pair & 0x1F);
+            else { putCode(b, book, chunk[i]); putCode(b, book, chunk[i+1]); }
+        }
+        if (i < n) putCode(b, book, chunk[i]);
+    }
     flush(b);
+    free(book);
+    ioClose(in);
+    ioClose(b->out);
     free(b);
+    STAT(stats.encode += now() - start - (stats.io - io));
+}
+
+/*
+    Number of symbols, 8 bytes little endian.
+*/
+void writeSize(FILE* out, unsigned long long size){
+    huff_t b[8];
+    int i;
+    for( i=0; i<8; i++ ) b[i] = size >> (8 * i);
+    fwrite(b, 1, 8, out);
 }
 
 void writeCode(FILE* table, char* code){
     fprintf(table, "%s\n", code);
 }
 
-char** getCodes(FILE* input){
+char** getCodes(FILE* input, unsigned long long* size){
     huff_freq_t* freqs = findFrequencies(input);
-    Node* trie = buildTrie(freqs);
+    int i;
+    *size = 0;
+    for( i=0; i<R; i++ ) *size += freqs[i];
+
+    STAT(double start = now());
+    huff_freq_t weights[R];
+    memcpy(weights, freqs, sizeof(weights));
+    rescale(weights);
+    Node* trie = buildTrie(weights);
     char** codes = (char**) malloc(R*sizeof(char*)) ;
     char tmp[R];
     createCodes(trie, tmp, 0, codes);
+    STAT(stats.tree += now() - start);
+
+    STAT(
+        for( i=0; i<R; i++ ){
+            int len = strlen(codes[i]);
+            stats.symbols += freqs[i];
+            stats.bits += freqs[i] * len;
+            if (freqs[i] && len > stats.maxDepth) stats.maxDepth = len;
+        }
+    )
+    free(freqs);
     return codes;
 }
 
 int main(int argc, char *argv[]){
+    char* program = argv[0];  // before options are shifted off
+    int printStatistics = argc > 1 && !strcmp(argv[1], "--stats");
+    if (printStatistics) { argv++; argc--; }
+
     if (argc != 4){
-        fprintf(stderr, "Have to provide input, table and output file.\nExample: %s input_file table_file output_file\n", argv[0]);
+        fprintf(stderr, "Have to provide input, table and output file.\nExample: %s [--stats] input_file table_file output_file\n", program);
         return 0;
     }
 
@@ -225,15 +401,23 @@ int main(int argc, char *argv[]){
     FILE* output = fopen(argv[3], "wb");
 
     fprintf(stderr, "Compressing...\n");
-    char** codes = getCodes(input);
+    unsigned long long size;
+    char** codes = getCodes(input, &size);
     int i;
+    STAT(double start = now());
     for(i=0;i<R;i++) writeCode(table, codes[i]);
-    long int size = ftell(input);
     fseek(input, 0L, SEEK_SET);
-    fwrite(&size, sizeof(size), 1, output);
+    writeSize(output, size);
+    STAT(stats.io += now() - start);
     compress(input, output, codes);
     fprintf(stderr, "Done!\n");
 
+#ifdef STATS
+    if (printStatistics) printStats(stdout);
+#else
+    if (printStatistics) fprintf(stderr, "Statistics are not compiled in, rebuild with -DSTATS\n");
+#endif
+
     for(i=0;i<R;i++) free(codes[i]);
     fclose(input);
     fclose(table);
@@ -0,0 +1,402 @@
+/***************************************************
+ * huffman -- canonical, length limited Huffman    *
+ *            coding of in-memory symbol blocks    *
+ ***************************************************/
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "huff/huffman.h"
+
+// byte loops of huffPutBytes and huffGetBytes
+#define HK_BITS 8
+#define HK_SYMBOL unsigned char
+#define HK_MAX_BITS HUFF_MAX_BITS
+#define HK_LOOKUP_BITS HUFF_LOOKUP_BITS
+#include "huff/huffkernel.h"
+
+// bit streams
+
+void initBitWriter(BitWriter* w, unsigned char* out, size_t capacity){
+    w->out = out;
+    w->pos = 0;
+    w->capacity = capacity;
+    w->acc = 0;
+    w->bits = 0;
+    w->overflow = 0;
+}
+
+size_t flushBits(BitWriter* w){
+    while (w->bits > 0){
+        if (w->pos == w->capacity) { w->overflow = 1; break; }
+        w->out[w->pos++] = w->acc;
+        w->acc >>= 8;
+        w->bits -= 8;
+    }
+    w->acc = 0;
+    w->bits = 0;
+    return w->pos;
+}
+
+void initBitReader(BitReader* r, const unsigned char* in, size_t size){
+    r->in = in;
+    r->pos = 0;
+    r->size = size;
+    r->acc = 0;
+    r->bits = 0;
+}
+
+// code lengths
+
+/*
+    Four partial histograms, so that runs of the same byte
+    do not wait on each other's increments.
+*/
+void huffHistogram(const unsigned char* src, size_t n, huff_freq_t* freqs){
+    huff_freq_t partial[4][256];
+    size_t i;
+    int s;
+
+    memset(partial, 0, sizeof(partial));
+    for( i=0; i+4<=n; i+=4 ){
+        partial[0][src[i]]++;
+        partial[1][src[i+1]]++;
+        partial[2][src[i+2]]++;
+        partial[3][src[i+3]]++;
+    }
+    for( ; i<n; i++ ) partial[0][src[i]]++;
+    for( s=0; s<256; s++ ) freqs[s] = partial[0][s] + partial[1][s] + partial[2][s] + partial[3][s];
+}
+
+/*
+    LSD radix sort of the packed keys, one byte per pass, through tmp of the
+    same size. Passes where every key has the same byte are skipped. Unlike
+    qsort it never allocates, so it is safe on the latency critical path.
+*/
+static void sortKeys(unsigned long long* keys, unsigned long long* tmp, int m, int bits){
+    unsigned long long* src = keys;
+    unsigned long long* dst = tmp;
+    int shift, i;
+
+    for( shift=0; shift<bits; shift+=8 ){
+        unsigned int count[256] = {0};
+        for( i=0; i<m; i++ ) count[src[i] >> shift & 0xFF]++;
+        if (count[src[0] >> shift & 0xFF] == (unsigned) m) continue;
+
+        unsigned int at = 0, c;
+        for( i=0; i<256; i++ ) { c = count[i]; count[i] = at; at += c; }
+        for( i=0; i<m; i++ ) dst[count[src[i] >> shift & 0xFF]++] = src[i];
+
+        unsigned long long* t = src; src = dst; dst = t;
+    }
+    if (src != keys) memcpy(keys, src, m * sizeof(keys[0]));
+}
+
+/*
+    Leaves are sorted by frequency, so the tree can be built with two queues
+    (leaves and merged nodes) instead of a priority queue. Depths that are
+    too long are then fixed on the per-length counts, and the lengths are
+    handed out again from the least frequent symbol up.
+*/
+void huffLengthsWith(const huff_freq_t* freqs, int n, int maxBits, unsigned char* lengths, void* scratch){
+    unsigned long long* weight = (unsigned long long*) scratch;
+    unsigned long long* keys = weight + 2*n;
+    int* parent = (int*) (keys + n);
+    int* sorted = parent + 2*n;
+    unsigned int count[HUFF_WIDE_BITS+2];
+    int m = 0, i;
+
+    memset(lengths, 0, n);
+    for( i=0; i<n; i++ ) if (freqs[i]) sorted[m++] = i;
+    if (m == 0) return;
+    if (m == 1) { lengths[sorted[0]] = 1; return; }
+
+    // huge counts are shifted down to fit the key, used symbols stay used
+    huff_freq_t max = 0;
+    int shift = 0;
+    for( i=0; i<m; i++ ) if (freqs[sorted[i]] > max) max = freqs[sorted[i]];
+    while (max >> shift >> HUFF_FREQ_BITS) shift++;
+
+    // sort by frequency, then by symbol, packed into one key
+    for( i=0; i<m; i++ ){
+        huff_freq_t f = freqs[sorted[i]] >> shift;
+        keys[i] = (f ? f : 1) << 20 | sorted[i];
+    }
+    sortKeys(keys, weight, m, HUFF_FREQ_BITS + 20);
+    for( i=0; i<m; i++ ) sorted[i] = keys[i] & ((1<<20) - 1);
+
+    for( i=0; i<m; i++ ) weight[i] = keys[i] >> 20;
+    int leaf = 0, node = m, next = m;
+    while (next < 2*m - 1){
+        int pick[2], k;
+        for( k=0; k<2; k++ ){
+            if (leaf < m && (node == next || weight[leaf] <= weight[node])) pick[k] = leaf++;
+            else                                                             pick[k] = node++;
+        }
+        weight[next] = weight[pick[0]] + weight[pick[1]];
+        parent[pick[0]] = parent[pick[1]] = next;
+        next++;
+    }
+
+    // depth of each node, root is the last one; reuse weight for depths
+    weight[2*m - 2] = 0;
+    for( i=2*m-3; i>=0; i-- ) weight[i] = weight[parent[i]] + 1;
+
+    for( i=0; i<=maxBits+1; i++ ) count[i] = 0;
+    for( i=0; i<m; i++ ) count[weight[i] > (unsigned) maxBits ? maxBits + 1 : weight[i]]++;
+
+    count[maxBits] += count[maxBits+1];
+    unsigned long long total = 0;
+    for( i=maxBits; i>0; i-- ) total += (unsigned long long) count[i] << (maxBits - i);
+    while (total != 1ULL << maxBits){
+        count[maxBits]--;
+        for( i=maxBits-1; i>0; i-- ){
+            if (count[i]) { count[i]--; count[i+1] += 2; break; }
+        }
+        total--;
+    }
+
+    int len, j = 0;
+    for( len=maxBits; len>0; len-- ){
+        unsigned int k;
+        for( k=0; k<count[len]; k++ ) lengths[sorted[j++]] = len;
+    }
+}
+
+void huffLengths(const huff_freq_t* freqs, int n, int maxBits, unsigned char* lengths){
+    unsigned long long scratch[HUFF_SCRATCH(HUFF_MAX_SYMBOLS) / sizeof(unsigned long long)];
+    huffLengthsWith(freqs, n, maxBits, lengths, scratch);
+}
+
+static unsigned int reverse(unsigned int code, int len){
+    unsigned int r = 0;
+    while (len--) { r = (r << 1) | (code & 1); code >>= 1; }
+    return r;
+}
+
+int huffCountLengths(const unsigned char* lengths, int n, int maxBits, unsigned int* count){
+    int i;
+
+    for( i=0; i<=maxBits; i++ ) count[i] = 0;
+    for( i=0; i<n; i++ ){
+        if (lengths[i] > maxBits) return -1;
+        count[lengths[i]]++;
+    }
+    count[0] = 0;
+
+    // over-subscribed set of lengths is not a prefix code
+    long long left = 1;
+    for( i=1; i<=maxBits; i++ ){
+        left = 2*left - count[i];
+        if (left < 0) return -1;
+    }
+    return 0;
+}
+
+void huffBuildCodes(const unsigned char* lengths, int n, int maxBits, unsigned int* codes){
+    unsigned int count[HUFF_WIDE_BITS+1];
+    unsigned int next[HUFF_WIDE_BITS+1];
+    unsigned int code = 0;
+    int i;
+
+    huffCountLengths(lengths, n, maxBits, count);
+    for( i=1; i<=maxBits; i++ ){
+        code = (code + count[i-1]) << 1;
+        next[i] = code;
+    }
+    for( i=0; i<n; i++ ) codes[i] = lengths[i] ? reverse(next[lengths[i]]++, lengths[i]) : 0;
+}
+
+int huffBuildTable(const unsigned char* lengths, int n, int maxBits, int lookupBits,
+                   unsigned int* table, unsigned int* count, unsigned short* sorted){
+    unsigned int next[HUFF_WIDE_BITS+1];
+    unsigned int offset[HUFF_WIDE_BITS+1];
+    int i;
+
+    if (huffCountLengths(lengths, n, maxBits, count)) return -1;
+    memset(table, 0, sizeof(unsigned int) << lookupBits);
+
+    // canonical codes start at 0 for the shortest length
+    unsigned int code = 0;
+    offset[1] = 0;
+    for( i=1; i<=maxBits; i++ ){
+        next[i] = code;
+        code = (code + count[i]) << 1;
+        if (i > 1) offset[i] = offset[i-1] + count[i-1];
+    }
+
+    for( i=0; i<n; i++ ){
+        int len = lengths[i];
+        if (!len) continue;
+        sorted[offset[len]++] = i;
+        if (len > lookupBits) { next[len]++; continue; }
+        unsigned int r = reverse(next[len]++, len);
+        for( ; r < (1u<<lookupBits); r += 1u<<len ) table[r] = (unsigned int) i << HUFF_ENTRY_BITS | len;
+    }
+    return 0;
+}
+
+void huffBuildEncoder(HuffEncoder* e, const unsigned char* lengths, int n){
+    memcpy(e->lengths, lengths, n);
+    huffBuildCodes(lengths, n, HUFF_MAX_BITS, e->codes);
+}
+
+int huffBuildDecoder(HuffDecoder* d, const unsigned char* lengths, int n){
+    return huffBuildTable(lengths, n, HUFF_MAX_BITS, HUFF_LOOKUP_BITS, d->table, d->count, d->sorted);
+}
+
+/*
+    Canonical decoding one bit at a time, for codes longer than the table.
+*/
+int huffGetSlowWith(BitReader* r, const unsigned int* count, const unsigned short* sorted, int maxBits){
+    int code = 0, first = 0, index = 0, len;
+    for( len=1; len<=maxBits; len++ ){
+        code |= (r->acc >> (len-1)) & 1;
+        int c = count[len];
+        if (code - c < first){
+            r->acc >>= len;
+            r->bits -= len;
+            return sorted[index + (code - first)];
+        }
+        index += c;
+        first += c;
+        first <<= 1;
+        code <<= 1;
+    }
+    return -1;
+}
+
+int huffGetSlow(BitReader* r, const HuffDecoder* d){
+    return huffGetSlowWith(r, d->count, d->sorted, HUFF_MAX_BITS);
+}
+
+// byte pairs
+
+int huffPairsPay(const HuffEncoder* e, size_t n){
+    int m = 0, a;
+
+    // short blocks do not pay for counting, and entries past a sixteenth
+    // of the bytes cost more than they save: every used byte adds a row
+    // of the table to the cache
+    if (n < 1<<HUFF_PAIR_BITS) return 0;
+    for( a=0; a<256; a++ ) m += e->lengths[a] != 0;
+    return (size_t) m * m * 16 <= n;
+}
+
+int huffBuildPairEncoder(HuffPairEncoder* p, const HuffEncoder* e, size_t n){
+    unsigned char used[256];
+    int m = 0, a, b;
+
+    if (!huffPairsPay(e, n)) return 0;
+    for( a=0; a<256; a++ ) if (e->lengths[a]) used[m++] = a;
+
+    // first code goes out first, so it takes the low bits
+    for( a=0; a<m; a++ ){
+        int first = used[a], l1 = e->lengths[first];
+        for( b=0; b<m; b++ ){
+            int second = used[b], len = l1 + e->lengths[second];
+            unsigned int code = e->codes[first] | (unsigned int) e->codes[second] << l1;
+            p->table[first | second << 8] = len > HUFF_PAIR_MAX_BITS ? 0 : code << 5 | len;
+        }
+    }
+    return 1;
+}
+
+int huffBuildPairDecoder(HuffPairDecoder* p, const HuffDecoder* d, size_t n){
+    const unsigned int mask = (1<<HUFF_LOOKUP_BITS) - 1;
+    unsigned int bits, pairs = 0;
+
+    if (n < 1<<HUFF_PAIR_BITS) return 0;
+    for( bits=0; bits<(1u<<HUFF_PAIR_BITS); bits++ ){
+        unsigned int first = d->table[bits & mask];
+        if (!first) { p->table[bits] = 0; continue; }
+
+        // second code has to end within the peeked bits too
+        int l1 = first & HUFF_ENTRY_MASK;
+        unsigned int second = d->table[(bits >> l1) & mask];
+        int l2 = second & HUFF_ENTRY_MASK;
+        if (second && l1 + l2 <= HUFF_PAIR_BITS) {
+            p->table[bits] = (first >> HUFF_ENTRY_BITS) | (second >> HUFF_ENTRY_BITS) << 8 | (l1 + l2) << 16 | 2u << 24;
+            pairs++;
+        } else
+            p->table[bits] = (first >> HUFF_ENTRY_BITS) | l1 << 16 | 1u << 24;
+    }
+    // share of entries is the odds of a pair, with few of them the
+    // single table is faster
+    return pairs * 2 >= 1u<<HUFF_PAIR_BITS;
+}
+
+void huffPutBytes(BitWriter* w, const HuffEncoder* e, const HuffPairEncoder* p, const unsigned char* src, size_t n){
+    size_t i = 0;
+    if (p) {
+        for( ; i+2<=n && !w->overflow; i+=2 ){
+            unsigned int pair = p->table[src[i] | src[i+1] << 8];
+            if (pair) putBits(w, pair >> 5, pair & 0x1F);
+            else { huffPut(w, e, src[i]); huffPut(w, e, src[i+1]); }
+        }
+    }
+    huffPutSymbols8(w, e->codes, e->lengths, src + i, n - i);
+}
+
+int huffGetBytes(BitReader* r, const HuffDecoder* d, const HuffPairDecoder* p, unsigned char* dst, size_t n){
+    size_t i = 0;
+    if (p) {
+        // last byte alone, a pair there could read past the end
+        while (i+1 < n) {
+            if (r->bits < HUFF_MAX_BITS) refill(r);
+            unsigned int entry = p->table[r->acc & ((1<<HUFF_PAIR_BITS) - 1)];
+            if (!entry) {
+                int symbol = huffGetSlow(r, d);
+                if (symbol < 0) return -1;
+                dst[i++] = symbol;
+                continue;
+            }
+            dst[i] = entry;
+            dst[i+1] = entry >> 8;
+            r->acc >>= (entry >> 16) & 0xFF;
+            r->bits -= (entry >> 16) & 0xFF;
+            i += entry >> 24;
+        }
+    }
+    return huffGetSymbols8(r, d->table, d->count, d->sorted, dst + i, n - i);
+}
+
+void huffWriteLengths(BitWriter* w, const unsigned char* lengths, int n){
+    int i;
+    for( i=0; i<n; i++ ) putBits(w, lengths[i], 4);
+}
+
+int huffReadLengths(BitReader* r, unsigned char* lengths, int n){
+    int i;
+    for( i=0; i<n; i++ ) lengths[i] = getBits(r, 4);
+    return overrun(r) ? -1 : 0;
+}
+
+/*
+    Sparse alphabets use few symbols, so runs of unused ones are cheaper
+    than lengthBits for each.
+*/
+void huffWriteLengthRuns(BitWriter* w, const unsigned char* lengths, int n, int lengthBits, int runBits){
+    int i = 0;
+    while (i < n){
+        putBits(w, lengths[i], lengthBits);
+        if (lengths[i++]) continue;
+        int run = 0;
+        while (i + run < n && !lengths[i + run]) run++;
+        putBits(w, run, runBits);
+        i += run;
+    }
+}
+
+int huffReadLengthRuns(BitReader* r, unsigned char* lengths, int n, int lengthBits, int runBits){
+    int i = 0;
+    while (i < n){
+        lengths[i] = getBits(r, lengthBits);
+        if (lengths[i++]) continue;
+        int run = getBits(r, runBits);
+        if (run > n - i) return -1;
+        memset(lengths + i, 0, run);
+        i += run;
+    }
+    return overrun(r) ? -1 : 0;
+}
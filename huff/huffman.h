@@ -0,0 +1,212 @@
+/***************************************************
+ * huffman -- canonical, length limited Huffman    *
+ *            coding of in-memory symbol blocks    *
+ *                                                 *
+ * Codes are canonical, so only code lengths have  *
+ * to be stored. Bits are packed LSB first, codes  *
+ * are kept bit-reversed so that decoding is one   *
+ * table lookup on the next HUFF_LOOKUP_BITS bits. *
+ ***************************************************/
+
+#ifndef HUFFMAN_H
+#define HUFFMAN_H
+
+#include <stddef.h>
+
+#define HUFF_MAX_SYMBOLS 512
+#define HUFF_MAX_BITS 15
+#define HUFF_LOOKUP_BITS 11
+
+// decoding table entry: symbol<<HUFF_ENTRY_BITS | length, room for wide codes
+#define HUFF_ENTRY_BITS 5
+#define HUFF_ENTRY_MASK ((1<<HUFF_ENTRY_BITS) - 1)
+
+// bits peeked by the pair decoder, and longest two codes the pair encoder
+// puts out at once, codes of two bytes share one lookup
+#define HUFF_PAIR_BITS 12
+#define HUFF_PAIR_MAX_BITS 27
+
+// counts of inputs past 4 GiB, huffLengths scales them down to HUFF_FREQ_BITS
+#define HUFF_FREQ_BITS 32
+
+typedef unsigned long long huff_freq_t;
+
+// longest code huffLengthsWith makes, and the scratch it needs for n symbols
+#define HUFF_WIDE_BITS 24
+#define HUFF_SCRATCH(n) ((size_t) (n) * (3 * sizeof(unsigned long long) + 3 * sizeof(int)))
+
+typedef struct BitWriter {
+    unsigned char* out;
+    size_t pos;
+    size_t capacity;
+    unsigned long long acc;
+    int bits;
+    int overflow;
+} BitWriter;
+
+typedef struct BitReader {
+    const unsigned char* in;
+    size_t pos;
+    size_t size;
+    unsigned long long acc;
+    int bits;
+} BitReader;
+
+typedef struct HuffEncoder {
+    unsigned int codes[HUFF_MAX_SYMBOLS];   // bit-reversed
+    unsigned char lengths[HUFF_MAX_SYMBOLS];
+} HuffEncoder;
+
+typedef struct HuffDecoder {
+    unsigned int table[1<<HUFF_LOOKUP_BITS]; // table entries, 0 for long codes
+    unsigned int count[HUFF_MAX_BITS+1];
+    unsigned short sorted[HUFF_MAX_SYMBOLS];
+} HuffDecoder;
+
+typedef struct HuffPairEncoder {
+    unsigned int table[1<<16];  // (first | second<<8) -> code<<5 | length, 0 when over HUFF_PAIR_MAX_BITS
+} HuffPairEncoder;
+
+typedef struct HuffPairDecoder {
+    unsigned int table[1<<HUFF_PAIR_BITS]; // first | second<<8 | length<<16 | count<<24, 0 for long codes
+} HuffPairDecoder;
+
+// bit streams
+
+void initBitWriter(BitWriter* w, unsigned char* out, size_t capacity);
+size_t flushBits(BitWriter* w); // returns number of bytes written
+void initBitReader(BitReader* r, const unsigned char* in, size_t size);
+
+static inline void putBits(BitWriter* w, unsigned long long value, int n){
+    w->acc |= value << w->bits;
+    w->bits += n;
+    if (w->bits >= 32){
+        if (w->pos + 4 <= w->capacity){
+            w->out[w->pos++] = w->acc;
+            w->out[w->pos++] = w->acc >> 8;
+            w->out[w->pos++] = w->acc >> 16;
+            w->out[w->pos++] = w->acc >> 24;
+        } else w->overflow = 1;
+        w->acc >>= 32;
+        w->bits -= 32;
+    }
+}
+
+static inline void refill(BitReader* r){
+    while (r->bits <= 56){
+        unsigned long long byte = r->pos < r->size ? r->in[r->pos] : 0;
+        r->acc |= byte << r->bits;
+        r->pos++;
+        r->bits += 8;
+    }
+}
+
+static inline unsigned int getBits(BitReader* r, int n){
+    if (r->bits < n) refill(r);
+    unsigned int value = r->acc & ((1ULL << n) - 1);
+    r->acc >>= n;
+    r->bits -= n;
+    return value;
+}
+
+// true when reader consumed more than the input it had
+static inline int overrun(const BitReader* r){
+    return r->pos > r->size && (r->pos - r->size) * 8 > (size_t) r->bits;
+}
+
+// codes
+
+/*
+    Byte histogram of a block, freqs has 256 entries.
+    Shared by every entropy coder that works on bytes.
+*/
+void huffHistogram(const unsigned char* src, size_t n, huff_freq_t* freqs);
+
+/*
+    Computes code lengths (at most maxBits) for n symbols with given frequencies.
+    Symbols with zero frequency get length 0.
+*/
+void huffLengths(const huff_freq_t* freqs, int n, int maxBits, unsigned char* lengths);
+
+/*
+    Same for alphabets over HUFF_MAX_SYMBOLS or codes up to HUFF_WIDE_BITS,
+    with scratch of HUFF_SCRATCH(n) bytes from the caller.
+*/
+void huffLengthsWith(const huff_freq_t* freqs, int n, int maxBits, unsigned char* lengths, void* scratch);
+
+/*
+    Builders for any alphabet of n symbols and codes up to maxBits (at most
+    HUFF_WIDE_BITS), which the fixed size coders below and the kernels of
+    huff/huffkernels.c share. huffCountLengths fills count[maxBits+1] with
+    codes of each length, huffBuildTable a decoding table of lookupBits,
+    count and sorted (symbols by code) for huffGetSlowWith. Both return 0,
+    or -1 if lengths are not a prefix code.
+*/
+int huffCountLengths(const unsigned char* lengths, int n, int maxBits, unsigned int* count);
+void huffBuildCodes(const unsigned char* lengths, int n, int maxBits, unsigned int* codes);
+int huffBuildTable(const unsigned char* lengths, int n, int maxBits, int lookupBits,
+                   unsigned int* table, unsigned int* count, unsigned short* sorted);
+int huffGetSlowWith(BitReader* r, const unsigned int* count, const unsigned short* sorted, int maxBits);
+
+void huffBuildEncoder(HuffEncoder* e, const unsigned char* lengths, int n);
+
+/*
+    Returns 0 if lengths describe a valid prefix code, -1 otherwise.
+*/
+int huffBuildDecoder(HuffDecoder* d, const unsigned char* lengths, int n);
+
+/*
+    Code lengths of 4 bits each, or lengthBits each with a zero followed
+    by runBits of further zeros, for alphabets that use few symbols.
+*/
+void huffWriteLengths(BitWriter* w, const unsigned char* lengths, int n);
+int huffReadLengths(BitReader* r, unsigned char* lengths, int n);
+void huffWriteLengthRuns(BitWriter* w, const unsigned char* lengths, int n, int lengthBits, int runBits);
+int huffReadLengthRuns(BitReader* r, unsigned char* lengths, int n, int lengthBits, int runBits);
+
+static inline void huffPut(BitWriter* w, const HuffEncoder* e, int symbol){
+    putBits(w, e->codes[symbol], e->lengths[symbol]);
+}
+
+int huffGetSlow(BitReader* r, const HuffDecoder* d);
+
+/*
+    Decodes one symbol, returns -1 on invalid input.
+*/
+static inline int huffGet(BitReader* r, const HuffDecoder* d){
+    if (r->bits < HUFF_MAX_BITS) refill(r);
+    unsigned int entry = d->table[r->acc & ((1<<HUFF_LOOKUP_BITS) - 1)];
+    if (!entry) return huffGetSlow(r, d);
+    r->acc >>= entry & HUFF_ENTRY_MASK;
+    r->bits -= entry & HUFF_ENTRY_MASK;
+    return entry >> HUFF_ENTRY_BITS;
+}
+
+// byte pairs
+
+/*
+    Tables for coding two bytes per lookup, built only when n bytes pay
+    for them: the encoder has an entry for every pair of used bytes, the
+    decoder one for every HUFF_PAIR_BITS bits. Return 1 if built, 0 if not.
+*/
+int huffBuildPairEncoder(HuffPairEncoder* p, const HuffEncoder* e, size_t n);
+int huffBuildPairDecoder(HuffPairDecoder* p, const HuffDecoder* d, size_t n);
+
+/*
+    1 if huffBuildPairEncoder would build the table, so callers can skip
+    allocating it.
+*/
+int huffPairsPay(const HuffEncoder* e, size_t n);
+
+/*
+    Codes n bytes, two at a time with p, one at a time if p is NULL.
+    Output is the same either way.
+*/
+void huffPutBytes(BitWriter* w, const HuffEncoder* e, const HuffPairEncoder* p, const unsigned char* src, size_t n);
+
+/*
+    Decodes exactly n bytes, returns 0 or -1 on invalid input.
+*/
+int huffGetBytes(BitReader* r, const HuffDecoder* d, const HuffPairDecoder* p, unsigned char* dst, size_t n);
+
+#endif
@@ -0,0 +1,78 @@
+/***************************************************
+ * lzh -- format shared by lzhkoder and lzhdekoder *
+ *                                                 *
+ * LZW code stream is split into blocks of at most *
+ * LZH_BLOCK codes. Every code is turned into a    *
+ * symbol (literal byte or width class) and extra  *
+ * bits; symbols get a Huffman table per block.    *
+ *                                                 *
+ * File:   "LZH1" block* end                       *
+ * block:  u32 codes, u32 bytes, payload           *
+ * end:    u32 0                                   *
+ * All integers are little endian.                 *
+ ***************************************************/
+
+#ifndef LZH_H
+#define LZH_H
+
+#include <stdio.h>
+
+#include "huff/huffman.h"
+#include "lzw/lzw.h"
+
+#define LZH_MAGIC "LZH1"
+#define LZH_BLOCK (1<<16)
+#define LZH_BUFFERS 4
+
+/*
+    Codes below 256 are literals. Bigger codes with highest bit w are
+    coded by class (w, next bit) followed by the w-1 remaining bits.
+*/
+#define LZH_CLASSES 16
+#define LZH_SYMBOLS (LZW_R + LZH_CLASSES)
+
+// lengths + worst case of 15 bit symbol and 14 extra bits per code
+#define LZH_PAYLOAD (LZH_SYMBOLS/2 + LZH_BLOCK*4 + 8)
+
+static inline int highestBit(unsigned int x){
+    return 31 - __builtin_clz(x);
+}
+
+static inline void lzhPut(BitWriter* w, const HuffEncoder* e, int code){
+    if (code < LZW_R) { huffPut(w, e, code); return; }
+    int width = highestBit(code);
+    int half = (code >> (width - 1)) & 1;
+    huffPut(w, e, LZW_R + 2*(width - 8) + half);
+    putBits(w, code & ((1 << (width - 1)) - 1), width - 1);
+}
+
+static inline int lzhSymbol(int code){
+    if (code < LZW_R) return code;
+    int width = highestBit(code);
+    return LZW_R + 2*(width - 8) + ((code >> (width - 1)) & 1);
+}
+
+/*
+    Returns next code, or -1 on invalid input.
+*/
+static inline int lzhGet(BitReader* r, const HuffDecoder* d){
+    int symbol = huffGet(r, d);
+    if (symbol < LZW_R) return symbol;
+    int width = 8 + (symbol - LZW_R) / 2;
+    int half = (symbol - LZW_R) & 1;
+    return (1 << width) | (half << (width - 1)) | getBits(r, width - 1);
+}
+
+static inline void writeU32(FILE* out, unsigned int x){
+    unsigned char b[4] = { x, x >> 8, x >> 16, x >> 24 };
+    fwrite(b, 1, 4, out);
+}
+
+static inline int readU32(FILE* in, unsigned int* x){
+    unsigned char b[4];
+    if (fread(b, 1, 4, in) != 4) return 0;
+    *x = b[0] | b[1] << 8 | b[2] << 16 | (unsigned int) b[3] << 24;
+    return 1;
+}
+
+#endif
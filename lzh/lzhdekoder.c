@@ -0,0 +1,149 @@
+/***************************************************
+ * lzhdekoder -- program to decode input file      *
+ *               encoded by lzhkoder               *
+ *                                                 *
+ * Usage:                                          *
+ *      lzhdekoder input output                    *
+ *          - input: input file                    *
+ *          - output: output file                  *
+ *                                                 *
+ * Huffman decoding runs on a second thread, LZW   *
+ * decoding of finished blocks on the main thread, *
+ * file reads and writes in the background.        *
+ ***************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+
+#include "common/iopipe.h"
+#include "common/queue.h"
+#include "lzh/lzh.h"
+
+#define OUT_BUFF (1<<20) // bigger than longest LZW phrase
+
+typedef struct Block {
+    lzw_code_t codes[LZH_BLOCK];
+    size_t n;
+} Block;
+
+typedef struct Pipeline {
+    Queue* full;   // decoded blocks waiting for LZW stage
+    Queue* free;
+    IoPipe* input;   // read only by the Huffman stage
+    int error;
+} Pipeline;
+
+/*
+    Reads LZW codes of one block back from its Huffman coded payload.
+*/
+int decodeBlock(Block* b, const unsigned char* payload, size_t size){
+    unsigned char lengths[LZH_SYMBOLS];
+    HuffDecoder d;
+    BitReader r;
+    size_t i;
+
+    initBitReader(&r, payload, size);
+    if (huffReadLengths(&r, lengths, LZH_SYMBOLS)) return -1;
+    if (huffBuildDecoder(&d, lengths, LZH_SYMBOLS)) return -1;
+    for( i=0; i<b->n; i++ ){
+        int code = lzhGet(&r, &d);
+        if (code < 0 || code >= LZW_DICT_SIZE) return -1;
+        b->codes[i] = code;
+    }
+    return overrun(&r) ? -1 : 0;
+}
+
+void* entropyStage(void* arg){
+    Pipeline* p = (Pipeline*) arg;
+    unsigned char* payload = (unsigned char*) malloc(LZH_PAYLOAD);
+    unsigned int n, size;
+
+    while( ioGetU32(p->input, &n) && n ){
+        if (n > LZH_BLOCK || !ioGetU32(p->input, &size) || size > LZH_PAYLOAD
+                || !ioGet(p->input, payload, size)) { p->error = 1; break; }
+        Block* b = (Block*) queuePop(p->free);
+        if (!b) break;
+        b->n = n;
+        if (decodeBlock(b, payload, size)) { p->error = 1; break; }
+        queuePush(p->full, b);
+    }
+    queueClose(p->full);
+    free(payload);
+    return NULL;
+}
+
+int decode(FILE* input, FILE* output){
+    char magic[4];
+    IoPipe* in = ioReader(fileno(input), IO_BUFFERS, IO_BUFFER_SIZE);
+    if (!ioGet(in, magic, 4) || memcmp(magic, LZH_MAGIC, 4)) { ioClose(in); return -1; }
+
+    fflush(output);
+    IoPipe* o = ioWriter(fileno(output), IO_BUFFERS, IO_BUFFER_SIZE);
+    Pipeline p;
+    p.full = newQueue(LZH_BUFFERS);
+    p.free = newQueue(LZH_BUFFERS);
+    p.input = in;
+    p.error = 0;
+
+    Block* blocks = (Block*) malloc(LZH_BUFFERS * sizeof(Block));
+    int i;
+    for( i=0; i<LZH_BUFFERS; i++ ) queuePush(p.free, &blocks[i]);
+
+    pthread_t entropy;
+    pthread_create(&entropy, NULL, entropyStage, &p);
+
+    LzwDecoder* lzw = (LzwDecoder*) malloc(sizeof(LzwDecoder));
+    lzwDecoderInit(lzw);
+    unsigned char* out = (unsigned char*) malloc(OUT_BUFF);
+
+    Block* b;
+    while( !lzw->error && (b = (Block*) queuePop(p.full)) ){
+        size_t pos = 0;
+        while( pos < b->n && !lzw->error ){
+            size_t used;
+            size_t bytes = lzwDecode(lzw, b->codes + pos, b->n - pos, &used, out, OUT_BUFF);
+            ioPut(o, out, bytes);
+            pos += used;
+        }
+        queuePush(p.free, b);
+    }
+
+    // unblock the reader if we stopped early
+    queueClose(p.free);
+    pthread_join(entropy, NULL);
+    int error = p.error || lzw->error;
+    if (ioClose(in)) error = 1;
+    if (ioClose(o)) error = 1;
+
+    free(out);
+    free(lzw);
+    free(blocks);
+    destroyQueue(p.full);
+    destroyQueue(p.free);
+    return error ? -1 : 0;
+}
+
+int main(int argc, char *argv[]){
+    if (argc != 3){
+        fprintf(stderr, "Have to provide input and output file.\nExample: %s input_file output_file\n", argv[0]);
+        return 0;
+    }
+
+    FILE* input  = fopen(argv[1], "rb");
+    FILE* output = fopen(argv[2], "wb");
+    if (!input || !output){
+        fprintf(stderr, "Can not open input or output file\n");
+        return -1;
+    }
+
+    fprintf(stderr, "Decoding...\n");
+    int error = decode(input, output);
+    fprintf(stderr, error ? "Corrupted input!\n" : "Done!\n");
+
+    fclose(input);
+    fclose(output);
+
+    return error ? -1 : 0;
+}
@@ -0,0 +1,149 @@
+/***************************************************
+ * lzhkoder -- program to encode input file using  *
+ *             LZW followed by Huffman coding of   *
+ *             the LZW code stream                 *
+ *                                                 *
+ * Usage:                                          *
+ *      lzhkoder input output                      *
+ *          - input: input file                    *
+ *          - output: output file                  *
+ *                                                 *
+ * LZW runs on the main thread, Huffman coding of  *
+ * finished blocks runs on a second thread, file   *
+ * reads and writes in the background.             *
+ ***************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+
+#include "common/iopipe.h"
+#include "common/queue.h"
+#include "lzh/lzh.h"
+
+typedef struct Block {
+    lzw_code_t codes[LZH_BLOCK];
+    size_t n;
+} Block;
+
+typedef struct Pipeline {
+    Queue* full;   // blocks waiting for Huffman stage
+    Queue* free;   // blocks LZW stage can fill
+    IoPipe* output;  // written only by the Huffman stage
+} Pipeline;
+
+/*
+    Huffman codes one block of LZW codes, returns payload size.
+*/
+size_t encodeBlock(const Block* b, unsigned char* out){
+    huff_freq_t freqs[LZH_SYMBOLS] = { 0 };
+    unsigned char lengths[LZH_SYMBOLS];
+    HuffEncoder e;
+    BitWriter w;
+    size_t i;
+
+    for( i=0; i<b->n; i++ ) freqs[lzhSymbol(b->codes[i])]++;
+    huffLengths(freqs, LZH_SYMBOLS, HUFF_MAX_BITS, lengths);
+    huffBuildEncoder(&e, lengths, LZH_SYMBOLS);
+
+    initBitWriter(&w, out, LZH_PAYLOAD);
+    huffWriteLengths(&w, lengths, LZH_SYMBOLS);
+    for( i=0; i<b->n; i++ ) lzhPut(&w, &e, b->codes[i]);
+    return flushBits(&w);
+}
+
+void* entropyStage(void* arg){
+    Pipeline* p = (Pipeline*) arg;
+    unsigned char* payload = (unsigned char*) malloc(LZH_PAYLOAD);
+    Block* b;
+    while( (b = (Block*) queuePop(p->full)) ){
+        size_t size = encodeBlock(b, payload);
+        ioPutU32(p->output, b->n);
+        ioPutU32(p->output, size);
+        ioPut(p->output, payload, size);
+        queuePush(p->free, b);
+    }
+    ioPutU32(p->output, 0);
+    free(payload);
+    return NULL;
+}
+
+/*
+    Returns 0 or -1 if reading or writing failed.
+*/
+int encode(FILE* input, FILE* output){
+    fflush(output);
+    IoPipe* in = ioReader(fileno(input), IO_BUFFERS, IO_BUFFER_SIZE);
+    Pipeline p;
+    p.full = newQueue(LZH_BUFFERS);
+    p.free = newQueue(LZH_BUFFERS);
+    p.output = ioWriter(fileno(output), IO_BUFFERS, IO_BUFFER_SIZE);
+
+    Block* blocks = (Block*) malloc(LZH_BUFFERS * sizeof(Block));
+    int i;
+    for( i=1; i<LZH_BUFFERS; i++ ) queuePush(p.free, &blocks[i]);
+
+    ioPut(p.output, LZH_MAGIC, 4);
+    pthread_t entropy;
+    pthread_create(&entropy, NULL, entropyStage, &p);
+
+    LzwEncoder* lzw = (LzwEncoder*) malloc(sizeof(LzwEncoder));
+    lzwEncoderInit(lzw);
+    Block* curr = &blocks[0];
+    curr->n = 0;
+
+    const unsigned char* chunk;
+    size_t n;
+    while( (chunk = ioRead(in, &n)) ){
+        size_t pos = 0;
+        while( pos < n ){
+            // every byte gives at most one code, so this piece fits in block
+            size_t piece = n - pos;
+            if (piece > LZH_BLOCK - curr->n) piece = LZH_BLOCK - curr->n;
+            curr->n += lzwEncode(lzw, chunk + pos, piece, curr->codes + curr->n);
+            pos += piece;
+            if (curr->n == LZH_BLOCK){
+                queuePush(p.full, curr);
+                curr = (Block*) queuePop(p.free);
+                curr->n = 0;
+            }
+        }
+    }
+    curr->n += lzwEncodeEnd(lzw, curr->codes + curr->n);
+    if (curr->n) queuePush(p.full, curr);
+
+    queueClose(p.full);
+    pthread_join(entropy, NULL);
+
+    int error = ioClose(in);
+    if (ioClose(p.output)) error = -1;
+    free(lzw);
+    free(blocks);
+    destroyQueue(p.full);
+    destroyQueue(p.free);
+    return error;
+}
+
+int main(int argc, char *argv[]){
+    if (argc != 3){
+        fprintf(stderr, "Have to provide input and output file.\nExample: %s input_file output_file\n", argv[0]);
+        return 0;
+    }
+
+    FILE* input  = fopen(argv[1], "rb");
+    FILE* output = fopen(argv[2], "wb");
+    if (!input || !output){
+        fprintf(stderr, "Can not open input or output file\n");
+        return -1;
+    }
+
+    fprintf(stderr, "Encoding...\n");
+    int error = encode(input, output);
+    fprintf(stderr, error ? "Failed!\n" : "Done!\n");
+
+    fclose(input);
+    fclose(output);
+
+    return error ? -1 : 0;
+}
@@ -3,6 +3,7 @@
 
 #define ERR -1
 #define WORD_CAPACITY 1<<3
+#define DICT_SIZE (1<<16)
 
 
 /*
@@ -49,12 +50,12 @@ trie_node* newNode(){
 }
 
 void destroyNode(trie_node* tn){
-	int i;
 	trie_map_node* tmn = tn->children;
 	while (tmn) {
+		trie_map_node* next = tmn->next;
 		destroyNode(tmn->value);
 		free(tmn);
-		tmn = tmn->next;
+		tmn = next;
 	}
 	free(tn);
 }
@@ -147,6 +148,7 @@ trie_t search(trie* t, string* s){
 	Inserts the given word into the trie and associates given value with it.
 */
 void insert(trie* t, string* s, trie_t value){
+	if (t->count == DICT_SIZE - 1) return;
 	trie_node* curr = t->root;
 	int i;
 	for( i=0; i<s->size; i++ ){
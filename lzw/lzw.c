@@ -0,0 +1,49 @@
+/**************************************************
+ * lzw -- LZW coding of in-memory buffers         *
+ **************************************************/
+
+#include "lzw/lzw.h"
+
+void lzwEncoderInit(LzwEncoder* e){
+	lzwEncoderInit16(e);
+}
+
+size_t lzwEncode(LzwEncoder* e, const unsigned char* src, size_t n, lzw_code_t* codes){
+	return lzwEncode16(e, src, n, codes);
+}
+
+size_t lzwEncodeEnd(LzwEncoder* e, lzw_code_t* codes){
+	return lzwEncodeEnd16(e, codes);
+}
+
+int lzwEncoderAdd(LzwEncoder* e, int prefix, int symbol){
+	return lzwEncoderAdd16(e, prefix, symbol);
+}
+
+void lzwEncoderMark(LzwEncoder* e, unsigned int* journal){
+	lzwEncoderMark16(e, journal);
+}
+
+void lzwEncoderReset(LzwEncoder* e){
+	lzwEncoderReset16(e);
+}
+
+void lzwDecoderInit(LzwDecoder* d){
+	lzwDecoderInit16(d);
+}
+
+size_t lzwDecode(LzwDecoder* d, const lzw_code_t* codes, size_t n, size_t* used, unsigned char* dst, size_t capacity){
+	return lzwDecode16(d, codes, n, used, dst, capacity);
+}
+
+int lzwDecoderAdd(LzwDecoder* d, int prefix, int symbol){
+	return lzwDecoderAdd16(d, prefix, symbol);
+}
+
+void lzwDecoderMark(LzwDecoder* d){
+	lzwDecoderMark16(d);
+}
+
+void lzwDecoderReset(LzwDecoder* d){
+	lzwDecoderReset16(d);
+}
@@ -0,0 +1,66 @@
+/**************************************************
+ * lzw -- LZW coding of in-memory buffers         *
+ *                                                *
+ * Produces the same code stream as lzwkoder:     *
+ * 256 single byte entries at start, dictionary   *
+ * stops growing at LZW_DICT_SIZE - 1 entries.    *
+ * Dictionary is a hash of (prefix, symbol) pairs *
+ * instead of a trie, so memory is fixed. Code is *
+ * the 16 bit instantiation of lzw/lzwkernel.h.   *
+ **************************************************/
+
+#ifndef LZW_H
+#define LZW_H
+
+#include <stddef.h>
+#include <string.h>
+
+#define LZW_DICT_SIZE (1<<16)
+#define LZW_HASH_BITS 17
+
+// 16 bit instantiation, lzw.c gives it the names below
+#define LK_BITS 16
+#define LK_CODE unsigned short
+#include "lzw/lzwkernel.h"
+
+typedef unsigned short lzw_code_t;
+typedef LzwEncoder16 LzwEncoder;
+typedef LzwDecoder16 LzwDecoder;
+
+void lzwEncoderInit(LzwEncoder* e);
+
+/*
+	Encodes n bytes, writes at most n codes and returns their number.
+	Last phrase stays pending until lzwEncodeEnd.
+*/
+size_t lzwEncode(LzwEncoder* e, const unsigned char* src, size_t n, lzw_code_t* codes);
+size_t lzwEncodeEnd(LzwEncoder* e, lzw_code_t* codes);
+
+/*
+	Adds phrase (prefix code, symbol) as the next code, returns it or
+	LZW_NONE if dictionary is full. Used to load a primed dictionary.
+*/
+int lzwEncoderAdd(LzwEncoder* e, int prefix, int symbol);
+
+/*
+	Remembers current dictionary, lzwEncoderReset goes back to it in time
+	proportional to the entries added since. Journal is a caller-owned
+	array of LZW_DICT_SIZE entries.
+*/
+void lzwEncoderMark(LzwEncoder* e, unsigned int* journal);
+void lzwEncoderReset(LzwEncoder* e);
+
+void lzwDecoderInit(LzwDecoder* d);
+
+/*
+	Decodes codes while their phrases fit in dst.
+	Number of consumed codes is stored in *used, returns bytes written.
+	Sets d->error on invalid code.
+*/
+size_t lzwDecode(LzwDecoder* d, const lzw_code_t* codes, size_t n, size_t* used, unsigned char* dst, size_t capacity);
+
+int lzwDecoderAdd(LzwDecoder* d, int prefix, int symbol);
+void lzwDecoderMark(LzwDecoder* d);
+void lzwDecoderReset(LzwDecoder* d);
+
+#endif
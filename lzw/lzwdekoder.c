@@ -7,17 +7,32 @@
  * Purpose:  TINF lab 2015/2016                     *
  *                                                  *
  * Usage:                                           *
- *      lzwdekoder input output                     *
+ *      lzwdekoder [--max-memory size] input output *
  *          - input: input file                     *
  *          - output: output file                   *
+ *          - --max-memory: limit like 1M or 64M    *
+ *                                                  *
+ * Every entry keeps its own copy of the phrase,    *
+ * which can add up to gigabytes. Under a budget    *
+ * entries are (prefix code, symbol) pairs of       *
+ * lzw/lzw.c instead, and I/O buffers shrink to     *
+ * what is left.                                    *
  ****************************************************/
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+
+#include "common/budget.h"
+#include "common/iopipe.h"
+#include "lzw/lzw.h"
 
 #define R (1<<8)
 #define WORD_CAPACITY (1<<3)
 #define DICT_CAPACITY (1<<16)
+#define CODES (1<<12)
+#define MIN_BUFFER DICT_CAPACITY  // longest phrase has to fit
+#define EMPTY 0xFFFF              // lzwkoder's only code for an empty input
 
 typedef unsigned short trie_t; // value stored in trie
 typedef unsigned char trie_key_t;
@@ -65,11 +80,20 @@ void print(string* s){
 	printf("\n");
 }
 
-void sWrite(FILE* out, string* s){
-	fwrite(s->buffer, sizeof(trie_key_t), s->size, out);
+void sWrite(IoPipe* out, string* s){
+	ioPut(out, s->buffer, s->size * sizeof(trie_key_t));
 }
 
-void decode(FILE* input, FILE* output){
+/*
+	Codes are read and phrases written through buffers that are filled
+	and drained in the background. Returns 0 or -1 if reading or writing
+	failed or a code is not in the dictionary.
+*/
+int decode(FILE* input, FILE* output){
+	fflush(output);
+	IoPipe* in  = ioReader(fileno(input), IO_BUFFERS, IO_BUFFER_SIZE);
+	IoPipe* out = ioWriter(fileno(output), IO_BUFFERS, IO_BUFFER_SIZE);
+
 	// create dictionary
 	string* dictionary[DICT_CAPACITY];
 	trie_key_t c = 0;
@@ -82,22 +106,31 @@ void decode(FILE* input, FILE* output){
 
 	trie_t dictIdx;
 	string* radna_rijec = newString();
-	if (!fread(&dictIdx, sizeof(trie_t), 1, input)) return;
+	int error = 0;
+	if (!ioGet(in, &dictIdx, sizeof(trie_t)) || dictIdx == EMPTY || dictIdx >= R) {
+		if (dictIdx != EMPTY && dictIdx >= R) error = -1;
+		if (ioClose(in)) error = -1;
+		if (ioClose(out)) error = -1;
+		return error;
+	}
 	radna_rijec = concatFirst(radna_rijec, dictionary[dictIdx]);
-	sWrite(output, radna_rijec);
+	sWrite(out, radna_rijec);
 
 
-    int cnt = 0;
-	while (fread(&dictIdx, sizeof(trie_t), 1, input)) {
+	while (ioGet(in, &dictIdx, sizeof(trie_t))) {
 
 		string* nova_rijec;
+		if (dictIdx > dictSize) {
+			error = -1;
+			break;
+		}
 		if (dictIdx < dictSize){
 			nova_rijec = dictionary[dictIdx];
 		} else {
 			nova_rijec = concatFirst(radna_rijec, radna_rijec);
 		}
 
-		sWrite(output, nova_rijec);
+		sWrite(out, nova_rijec);
 
         if (dictSize != (DICT_CAPACITY-1)) {
             dictionary[dictSize++] = concatFirst(radna_rijec, nova_rijec);
@@ -108,28 +141,102 @@ void decode(FILE* input, FILE* output){
 
 	};
 
+	if (ioClose(in)) error = -1;
+	if (ioClose(out)) error = -1;
+
 	// destroy
 	do {
 		destroyString(dictionary[dictSize-1]);
 	} while(--dictSize);
+	return error;
 }
 
 
+/*
+	Decodes with a fixed size dictionary and two buffers of bufferSize
+	bytes in each direction, returns 0 or -1 on invalid code.
+*/
+int decodeCompact(FILE* input, FILE* output, size_t bufferSize){
+	LzwDecoder* d = (LzwDecoder*) malloc(sizeof(LzwDecoder));
+	lzw_code_t codes[CODES];
+	size_t n = 0, i = 0, filled = 0;
+
+	fflush(output);
+	IoPipe* in  = ioReader(fileno(input), 2, bufferSize);
+	IoPipe* out = ioWriter(fileno(output), 2, bufferSize);
+	unsigned char* buffer = ioBuffer(out);
+
+	lzwDecoderInit(d);
+	int first = 1;
+	while (!d->error) {
+		if (i == n) {
+			for( n=0; n<CODES && ioGet(in, &codes[n], sizeof(lzw_code_t)); n++ );
+			i = 0;
+			if (first && n == 1 && codes[0] == EMPTY) n = 0;
+			first = 0;
+			if (!n) break;
+		}
+
+		size_t used;
+		filled += lzwDecode(d, codes + i, n - i, &used, buffer + filled, bufferSize - filled);
+		i += used;
+		if (i < n && !d->error) {
+			ioWrite(out, filled);
+			buffer = ioBuffer(out);
+			filled = 0;
+		}
+	}
+	ioWrite(out, filled);
+
+	int error = d->error;
+	ioClose(in);
+	if (ioClose(out)) error = 1;
+	free(d);
+	return error ? -1 : 0;
+}
+
 int main(int argc, char *argv[]){
+	char* program = argv[0];  // before options are shifted off
+	unsigned long long budget = 0;
+	if (argc > 2 && !strcmp(argv[1], "--max-memory")) {
+		budget = budgetParse(argv[2]);
+		if (!budget) {
+			fprintf(stderr, "Invalid memory budget %s, expected a size like 1M or 64M\n", argv[2]);
+			return -1;
+		}
+		argv += 2;
+		argc -= 2;
+	}
+
 	if (argc != 3){
-		fprintf(stderr, "Have to provide input and output file.\nExample: %s input_file output_file\n", argv[0]);
+		fprintf(stderr, "Have to provide input and output file.\nExample: %s [--max-memory size] input_file output_file\n", program);
 		return 0;
 	}
 
+	// what is left after the dictionary goes to 2 input and 2 output buffers
+	unsigned long long fixed = sizeof(LzwDecoder);
+	size_t bufferSize = IO_BUFFER_SIZE;
+	if (budget) {
+		if (budget < fixed + 4 * MIN_BUFFER) {
+			fprintf(stderr, "Memory budget too small, need at least %llu KiB\n", (fixed + 4 * MIN_BUFFER) / KiB + 1);
+			return -1;
+		}
+		if ((budget - fixed) / 4 < bufferSize) bufferSize = (budget - fixed) / 4;
+	}
+
 	FILE* input  = fopen(argv[1], "rb");
 	FILE* output = fopen(argv[2], "wb");
 
 	fprintf(stderr, "Decoding...\n");
-	decode(input, output);
-	fprintf(stderr, "Done!\n");
+	int error = 0;
+	if (budget) error = decodeCompact(input, output, bufferSize);
+	else        error = decode(input, output);
+	fprintf(stderr, error ? "Failed!\n" : "Done!\n");
+
+	if (budget) budgetReport(budget, fixed + 4 * bufferSize, "prefix table");
 
 	fclose(input);
 	fclose(output);
 
-	return 0;
+	return error ? -1 : 0;
 }
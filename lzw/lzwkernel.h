@@ -0,0 +1,281 @@
+/**************************************************
+ * lzwkernel -- LZW coding of in-memory buffers   *
+ *              with fixed width codes, included  *
+ *              once per instantiation            *
+ *                                                *
+ * Parameters, undefined again at the end:        *
+ *   LK_BITS    code width, dictionary has        *
+ *              2^LK_BITS - 1 entries             *
+ *   LK_CODE    type that holds a code            *
+ *   LK_BLOCK   also generate the one-shot block  *
+ *              kernel, needs huff/huffman.h and  *
+ *              lzw/lzwkernels.h                  *
+ *                                                *
+ * Generates LzwEncoder<bits>, LzwDecoder<bits>   *
+ * and their functions, the API of lzw/lzw.h for  *
+ * that width; lzw.h is the 16 bit one. With      *
+ * LK_BLOCK also LzwKernel<bits> (the             *
+ * workspace), lzwKernelEncode<bits> and          *
+ * lzwKernelDecode<bits>.                         *
+ *                                                *
+ * Block: codes of LK_BITS bits each, with the    *
+ *        bit packing of huff/huffman.h.          *
+ **************************************************/
+
+#ifndef LZWKERNEL_H
+#define LZWKERNEL_H
+
+#define LZW_R (1<<8)
+#define LZW_NONE (-1)
+
+#endif
+
+#define LK_CAT(a, b) a##b
+#define LK_NAME(name, bits) LK_CAT(name, bits)
+#define LK(name) LK_NAME(name, LK_BITS)
+
+#define LK_DICT_SIZE (1 << LK_BITS)
+#define LK_HASH_BITS (LK_BITS + 1)
+#define LK_HASH_MASK ((1 << LK_HASH_BITS) - 1)
+
+typedef struct LK(LzwEncoder) {
+	unsigned int keys[1<<LK_HASH_BITS];    // (prefix<<8 | symbol) + 1, 0 is empty
+	LK_CODE values[1<<LK_HASH_BITS];
+	int count;
+	int prefix;                            // code of current phrase
+	int base;                              // count at lzwEncoderMark
+	unsigned int* journal;                 // slots filled since the mark
+} LK(LzwEncoder);
+
+typedef struct LK(LzwDecoder) {
+	LK_CODE prefix[LK_DICT_SIZE];
+	unsigned char suffix[LK_DICT_SIZE];
+	unsigned char first[LK_DICT_SIZE];
+	unsigned int length[LK_DICT_SIZE];
+	int count;
+	int previous;
+	int error;
+	int base;                              // count at lzwDecoderMark
+} LK(LzwDecoder);
+
+static inline unsigned int LK(slot)(unsigned int key){
+	return (key * 2654435761u) >> (32 - LK_HASH_BITS);
+}
+
+static inline void LK(lzwEncoderInit)(LK(LzwEncoder)* e){
+	memset(e->keys, 0, sizeof(e->keys));
+	e->count = LZW_R;
+	e->prefix = LZW_NONE;
+	e->base = LZW_R;
+	e->journal = NULL;
+}
+
+static inline size_t LK(lzwEncode)(LK(LzwEncoder)* e, const unsigned char* src, size_t n, LK_CODE* codes){
+	size_t i = 0, out = 0;
+	int prefix = e->prefix;
+	if (n && prefix == LZW_NONE) prefix = src[i++];
+
+	for( ; i<n; i++ ){
+		unsigned int key = ((unsigned int) prefix << 8 | src[i]) + 1;
+		unsigned int h = LK(slot)(key);
+		while (e->keys[h] && e->keys[h] != key) h = (h + 1) & LK_HASH_MASK;
+
+		if (e->keys[h]) {
+			prefix = e->values[h];
+			continue;
+		}
+
+		codes[out++] = prefix;
+		if (e->count < LK_DICT_SIZE - 1) {
+			if (e->journal) e->journal[e->count - e->base] = h;
+			e->keys[h] = key;
+			e->values[h] = e->count++;
+		}
+		prefix = src[i];
+	}
+
+	e->prefix = prefix;
+	return out;
+}
+
+static inline size_t LK(lzwEncodeEnd)(LK(LzwEncoder)* e, LK_CODE* codes){
+	if (e->prefix == LZW_NONE) return 0;
+	codes[0] = e->prefix;
+	e->prefix = LZW_NONE;
+	return 1;
+}
+
+static inline int LK(lzwEncoderAdd)(LK(LzwEncoder)* e, int prefix, int symbol){
+	if (e->count >= LK_DICT_SIZE - 1) return LZW_NONE;
+	unsigned int key = ((unsigned int) prefix << 8 | symbol) + 1;
+	unsigned int h = LK(slot)(key);
+	while (e->keys[h] && e->keys[h] != key) h = (h + 1) & LK_HASH_MASK;
+	if (e->keys[h]) return e->values[h];
+	e->keys[h] = key;
+	e->values[h] = e->count;
+	return e->count++;
+}
+
+/*
+	Entries added after the mark only took empty slots, and probing for
+	older entries never went past them, so emptying those slots again
+	gives back exactly the marked table.
+*/
+static inline void LK(lzwEncoderMark)(LK(LzwEncoder)* e, unsigned int* journal){
+	e->base = e->count;
+	e->journal = journal;
+	e->prefix = LZW_NONE;
+}
+
+static inline void LK(lzwEncoderReset)(LK(LzwEncoder)* e){
+	int i;
+	for( i=e->base; i<e->count; i++ ) e->keys[e->journal[i - e->base]] = 0;
+	e->count = e->base;
+	e->prefix = LZW_NONE;
+}
+
+static inline void LK(lzwDecoderInit)(LK(LzwDecoder)* d){
+	int c;
+	for( c=0; c<LZW_R; c++ ){
+		d->first[c] = c;
+		d->length[c] = 1;
+	}
+	d->count = LZW_R;
+	d->previous = LZW_NONE;
+	d->error = 0;
+	d->base = LZW_R;
+}
+
+static inline int LK(lzwDecoderAdd)(LK(LzwDecoder)* d, int prefix, int symbol){
+	if (d->count >= LK_DICT_SIZE - 1 || prefix >= d->count) return LZW_NONE;
+	int k = d->count++;
+	d->prefix[k] = prefix;
+	d->suffix[k] = symbol;
+	d->first[k] = d->first[prefix];
+	d->length[k] = d->length[prefix] + 1;
+	return k;
+}
+
+static inline void LK(lzwDecoderMark)(LK(LzwDecoder)* d){
+	d->base = d->count;
+	d->previous = LZW_NONE;
+}
+
+static inline void LK(lzwDecoderReset)(LK(LzwDecoder)* d){
+	d->count = d->base;
+	d->previous = LZW_NONE;
+	d->error = 0;
+}
+
+/*
+	Writes phrase of code backwards, from dst + length(code).
+*/
+static inline void LK(phrase)(const LK(LzwDecoder)* d, int code, unsigned char* dst){
+	unsigned char* p = dst + d->length[code];
+	while (code >= LZW_R) {
+		*--p = d->suffix[code];
+		code = d->prefix[code];
+	}
+	*--p = code;
+}
+
+static inline size_t LK(lzwDecode)(LK(LzwDecoder)* d, const LK_CODE* codes, size_t n, size_t* used, unsigned char* dst, size_t capacity){
+	size_t i, out = 0;
+	for( i=0; i<n; i++ ){
+		int code = codes[i];
+		int prev = d->previous;
+		size_t len;
+
+		if (code < d->count)                            len = d->length[code];
+		else if (code == d->count && prev != LZW_NONE)  len = d->length[prev] + 1;
+		else { d->error = 1; break; }
+
+		if (out + len > capacity) break;
+
+		if (code < d->count) {
+			LK(phrase)(d, code, dst + out);
+		} else {
+			// phrase is previous one followed by its own first symbol
+			LK(phrase)(d, prev, dst + out);
+			dst[out + len - 1] = d->first[prev];
+		}
+
+		if (prev != LZW_NONE && d->count < LK_DICT_SIZE - 1) {
+			int k = d->count++;
+			d->prefix[k] = prev;
+			d->suffix[k] = dst[out];
+			d->first[k] = d->first[prev];
+			d->length[k] = d->length[prev] + 1;
+		}
+
+		out += len;
+		d->previous = code;
+	}
+	*used = i;
+	return out;
+}
+
+#ifdef LK_BLOCK
+
+#define LK_CHUNK 4096   // bytes coded between packing runs
+
+typedef union LK(LzwKernel) {
+	LK(LzwEncoder) e;
+	LK(LzwDecoder) d;
+} LK(LzwKernel);
+
+/*
+	Encodes n bytes into dst, returns encoded size or LZW_KERNEL_FULL if it
+	does not fit. Empty input takes no bytes. Work is a LzwKernel of this
+	width.
+*/
+static size_t LK(lzwKernelEncode)(void* work, const unsigned char* src, size_t n, unsigned char* dst, size_t capacity){
+	LK(LzwEncoder)* e = &((LK(LzwKernel)*) work)->e;
+	LK_CODE codes[LK_CHUNK];
+	BitWriter w;
+	size_t pos, count, i;
+
+	initBitWriter(&w, dst, capacity);
+	LK(lzwEncoderInit)(e);
+	for( pos=0; pos<n && !w.overflow; pos+=LK_CHUNK ){
+		count = LK(lzwEncode)(e, src + pos, n - pos < LK_CHUNK ? n - pos : LK_CHUNK, codes);
+		for( i=0; i<count; i++ ) putBits(&w, codes[i], LK_BITS);
+	}
+	count = LK(lzwEncodeEnd)(e, codes);
+	for( i=0; i<count; i++ ) putBits(&w, codes[i], LK_BITS);
+
+	size_t size = flushBits(&w);
+	return w.overflow ? LZW_KERNEL_FULL : size;
+}
+
+/*
+	Decodes exactly n bytes, returns 0 or -1 on corrupted input.
+*/
+static int LK(lzwKernelDecode)(void* work, const unsigned char* src, size_t size, unsigned char* dst, size_t n){
+	LK(LzwDecoder)* d = &((LK(LzwKernel)*) work)->d;
+	BitReader r;
+	size_t out = 0, used;
+
+	initBitReader(&r, src, size);
+	LK(lzwDecoderInit)(d);
+	while (out < n) {
+		// codes are read one at a time, reading ahead could run past the end
+		LK_CODE code = getBits(&r, LK_BITS);
+		out += LK(lzwDecode)(d, &code, 1, &used, dst + out, n - out);
+		if (!used) return -1;
+	}
+	return overrun(&r) ? -1 : 0;
+}
+
+#undef LK_CHUNK
+#undef LK_BLOCK
+#endif
+
+#undef LK_CAT
+#undef LK_NAME
+#undef LK
+#undef LK_DICT_SIZE
+#undef LK_HASH_BITS
+#undef LK_HASH_MASK
+#undef LK_BITS
+#undef LK_CODE
@@ -0,0 +1,57 @@
+/**************************************************
+ * lzwkernels -- LZW kernels with 12, 16 and 20   *
+ *               bit codes, picked at run time    *
+ **************************************************/
+
+#include <string.h>
+
+#include "huff/huffman.h"
+#include "lzw/lzwkernels.h"
+
+// not through lzw/lzw.h, that one is the 16 bit instantiation without LK_BLOCK
+#define LK_BITS 12
+#define LK_CODE unsigned short
+#define LK_BLOCK
+#include "lzw/lzwkernel.h"
+
+#define LK_BITS 16
+#define LK_CODE unsigned short
+#define LK_BLOCK
+#include "lzw/lzwkernel.h"
+
+#define LK_BITS 20
+#define LK_CODE unsigned int
+#define LK_BLOCK
+#include "lzw/lzwkernel.h"
+
+static const LzwKernelOps kernels[] = {
+	{ 12, sizeof(LzwKernel12), lzwKernelEncode12, lzwKernelDecode12 },
+	{ 16, sizeof(LzwKernel16), lzwKernelEncode16, lzwKernelDecode16 },
+	{ 20, sizeof(LzwKernel20), lzwKernelEncode20, lzwKernelDecode20 },
+};
+#define KERNELS ((int) (sizeof(kernels) / sizeof(kernels[0])))
+
+const LzwKernelOps* lzwKernel(int bits){
+	int i;
+	for( i=0; i<KERNELS; i++ )
+		if (kernels[i].bits == bits) return &kernels[i];
+	return NULL;
+}
+
+/*
+	Every code adds an entry. Phrases are some 4 bytes long on text,
+	so n bytes make about n / 4 entries.
+*/
+const LzwKernelOps* lzwKernelFor(size_t n){
+	int i;
+	for( i=0; i<KERNELS-1; i++ )
+		if (n / 4 < ((size_t) 1 << kernels[i].bits)) break;
+	return &kernels[i];
+}
+
+/*
+	At most one code per byte, putBits may give up with 3 bytes still free.
+*/
+size_t lzwKernelBound(const LzwKernelOps* k, size_t n){
+	return (n * k->bits + 7) / 8 + 4;
+}
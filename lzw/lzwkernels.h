@@ -0,0 +1,50 @@
+/**************************************************
+ * lzwkernels -- LZW kernels with 12, 16 and 20   *
+ *               bit codes, picked at run time    *
+ *                                                *
+ * Every width is its own instantiation of        *
+ * lzw/lzwkernel.h, the coder of lzw/lzw.c with   *
+ * packed codes. Narrow codes cost less per       *
+ * phrase on small inputs, wide ones keep the     *
+ * dictionary growing on big ones.                *
+ **************************************************/
+
+#ifndef LZWKERNELS_H
+#define LZWKERNELS_H
+
+#include <stddef.h>
+
+#define LZW_KERNEL_FULL ((size_t) -1)
+
+typedef struct LzwKernelOps {
+	int bits;               // code width
+	size_t workspace;       // bytes of workspace, owned by the caller
+
+	/*
+		Encodes n bytes, returns encoded size or LZW_KERNEL_FULL if it
+		does not fit. Empty input takes no bytes.
+	*/
+	size_t (*encode)(void* work, const unsigned char* src, size_t n, unsigned char* dst, size_t capacity);
+
+	/*
+		Decodes exactly n bytes, returns 0 or -1 on corrupted input.
+	*/
+	int (*decode)(void* work, const unsigned char* src, size_t size, unsigned char* dst, size_t n);
+} LzwKernelOps;
+
+/*
+	Kernel with the given code width, NULL if there is none.
+*/
+const LzwKernelOps* lzwKernel(int bits);
+
+/*
+	Narrowest kernel whose dictionary does not fill up on n bytes.
+*/
+const LzwKernelOps* lzwKernelFor(size_t n);
+
+/*
+	Encoded n bytes are never bigger than this.
+*/
+size_t lzwKernelBound(const LzwKernelOps* k, size_t n);
+
+#endif
@@ -7,18 +7,36 @@
  * Purpose:  TINF lab 2015/2016                   *
  *                                                *
  * Usage:                                         *
- *      lzwkoder input output                     *
+ *      lzwkoder [--stats] [--max-memory size]    *
+ *               input output                     *
  *          - input: input file                   *
  *          - output: output file                 *
+ *          - --stats: print JSON report to       *
+ *                     stdout (needs -DSTATS)     *
+ *          - --max-memory: limit for the         *
+ *            dictionary and I/O buffers, like    *
+ *            512K or 64M                         *
+ *                                                *
+ * Full trie takes over 2 KiB per entry. Under a  *
+ * smaller budget the dictionary is kept in the   *
+ * hash of lzw/lzw.c (same output), or if even    *
+ * that does not fit, the trie stops growing      *
+ * earlier. lzwdekoder reads all of them.         *
  **************************************************/
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+
+#include "common/budget.h"
+#include "common/iopipe.h"
+#include "lzw/lzw.h"
 
 #define R (256)
 #define ERR (-1)
 #define WORD_CAPACITY (1<<3)
 #define DICT_SIZE (1<<16)
+#define CHUNK (1<<16)   // I/O buffers under a budget, 2 each way
 
 
 /*
@@ -38,6 +56,7 @@ typedef struct trie_node {
 typedef struct trie {
 	trie_node* root;
 	trie_t count;
+	trie_t limit;  // dictionary stops growing at this many entries
 } trie;
 
 typedef struct string {
@@ -46,6 +65,45 @@ typedef struct string {
 	int size;
 } string;
 
+/*
+	Hot path counters, only compiled in with -DSTATS.
+	Everything inside STAT(...) disappears from a normal build.
+*/
+#ifdef STATS
+#include <time.h>
+
+#define STAT(...) __VA_ARGS__
+
+typedef struct Stats {
+	double seconds;
+	unsigned long long bytes;    // input bytes
+	unsigned long long codes;    // output codes
+	unsigned long long nodes;    // trie nodes allocated
+	unsigned long long lookups;  // child lookups
+	long long fillPoint;         // input offset when dictionary got full
+} Stats;
+
+static Stats stats = { 0, 0, 0, 0, 0, -1 };
+
+static double now(){
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void printStats(FILE* out){
+	fprintf(out, "{\"codec\": \"lzw\", \"encode_s\": %.6f, \"bytes\": %llu, \"codes\": %llu, "
+	             "\"dict_fill_point\": %lld, \"avg_phrase_length\": %.4f, \"trie_nodes\": %llu, "
+	             "\"trie_bytes\": %llu, \"lookups_per_byte\": %.4f}\n",
+		stats.seconds, stats.bytes, stats.codes, stats.fillPoint,
+		stats.codes ? stats.bytes / (double) stats.codes : 0,
+		stats.nodes, stats.nodes * (unsigned long long) sizeof(trie_node),
+		stats.bytes ? stats.lookups / (double) stats.bytes : 0);
+}
+#else
+#define STAT(...)
+#endif
+
 // "constructors"
 
 /*
@@ -54,6 +112,7 @@ typedef struct string {
 trie_node* newNode(){
 	int i;
 	trie_node* tn = (trie_node*) malloc(sizeof(trie_node));
+	STAT(stats.nodes++);
 	tn->value = ERR;
 	for( i=0; i<R; i++ ) tn->children[i] = NULL;
 	return tn;
@@ -75,6 +134,7 @@ trie* newTrie(){
 	trie* t = (trie*) malloc(sizeof(trie));
 	t->root = newNode();
 	t->count = 0;
+	t->limit = DICT_SIZE - 1;
 	return t;
 }
 
@@ -123,7 +183,8 @@ trie_t search(trie* t, string* s){
 	Inserts the given word into the trie and associates given value with it.
 */
 void insert(trie* t, string* s){
-    if (t->count == DICT_SIZE - 1) return;
+	STAT(stats.lookups += s->size);
+	if (t->count == t->limit) return;
 	trie_node* curr = t->root;
 	int i;
 	for( i=0; i<s->size; i++ ){
@@ -134,8 +195,9 @@ void insert(trie* t, string* s){
 	curr->value = t->count++;
 }
 
-trie* initialize(){
+trie* initialize(trie_t limit){
 	trie* t = newTrie();
+	t->limit = limit;
 	trie_key_t c = 0;
 	do {
 		t->root->children[c]        = newNode();
@@ -145,53 +207,139 @@ trie* initialize(){
 	return t;
 }
 
-void iWrite(FILE* out, trie_t idx){
-	fwrite(&idx, sizeof(trie_t), 1, out);
+void iWrite(IoPipe* out, trie_t idx){
+	STAT(stats.codes++);
+	ioPut(out, &idx, sizeof(trie_t));
 }
 
-void encode(FILE* input, FILE* output){
-	trie* t = initialize();
+/*
+	Input is read and codes written through buffers that are filled and
+	drained in the background. Returns 0 or -1 if reading or writing failed.
+*/
+int encode(FILE* input, FILE* output, trie_t limit, int buffers, size_t bufferSize){
+	STAT(double start = now());
+	fflush(output);
+	IoPipe* in  = ioReader(fileno(input), buffers, bufferSize);
+	IoPipe* out = ioWriter(fileno(output), buffers, bufferSize);
+	trie* t = initialize(limit);
 	trie_node* curr = t->root;
-	trie_key_t novi_simbol;
+	const trie_key_t* chunk;
+	size_t n, i;
 
 	string* radna_rijec = newString();
-	while (sizeof(trie_key_t) == fread(&novi_simbol, sizeof(trie_key_t), 1, input)) {
+	while ( (chunk = ioRead(in, &n)) ) for( i=0; i<n; i++ ) {
+		trie_key_t novi_simbol = chunk[i];
 		trie_node* next = curr->children[novi_simbol];
+		STAT(stats.bytes++, stats.lookups++);
 
 		append(radna_rijec, novi_simbol);
 		if (!next) {
-			iWrite(output, curr->value);
+			iWrite(out, curr->value);
 			insert(t, radna_rijec);
+			STAT(if (stats.fillPoint < 0 && t->count == t->limit) stats.fillPoint = stats.bytes);
 			destroyString(radna_rijec);
 			radna_rijec = newString();
 			append(radna_rijec, novi_simbol);
 			next = t->root->children[novi_simbol];
+			STAT(stats.lookups++);
 		}
 		curr = next;
 	};
 
-	iWrite(output, curr->value);
+	iWrite(out, curr->value);
 
+	int error = ioClose(in);
+	if (ioClose(out)) error = -1;
 	destroyString(radna_rijec);
 	destroyTrie(t);
+	STAT(stats.seconds += now() - start);
+	return error;
+}
+
+/*
+	Same code stream as encode, with the dictionary in a fixed size hash
+	and buffers of CHUNK bytes. Returns 0 or -1 if reading or writing failed.
+*/
+int encodeCompact(FILE* input, FILE* output){
+	STAT(double start = now());
+	fflush(output);
+	IoPipe* in  = ioReader(fileno(input), 2, CHUNK);
+	IoPipe* out = ioWriter(fileno(output), 2, CHUNK);
+	LzwEncoder* e = (LzwEncoder*) malloc(sizeof(LzwEncoder));
+	lzw_code_t* codes = (lzw_code_t*) malloc((CHUNK + 1) * sizeof(lzw_code_t));
+	const unsigned char* chunk;
+	size_t n;
+
+	lzwEncoderInit(e);
+	while( (chunk = ioRead(in, &n)) ){
+		size_t count = lzwEncode(e, chunk, n, codes);
+		ioPut(out, codes, count * sizeof(lzw_code_t));
+		STAT(stats.bytes += n, stats.codes += count);
+	}
+	n = lzwEncodeEnd(e, codes);
+	ioPut(out, codes, n * sizeof(lzw_code_t));
+	STAT(stats.codes += n);
+
+	int error = ioClose(in);
+	if (ioClose(out)) error = -1;
+	free(codes);
+	free(e);
+	STAT(stats.seconds += now() - start);
+	return error;
 }
 
 
 int main(int argc, char *argv[]){
+	char* program = argv[0];  // before options are shifted off
+	int printStatistics = 0;
+	unsigned long long budget = 0;
+	for( ; argc > 1 && !strncmp(argv[1], "--", 2); argv++, argc-- ){
+		if (!strcmp(argv[1], "--stats")) printStatistics = 1;
+		else if (!strcmp(argv[1], "--max-memory") && argc > 2 && (budget = budgetParse(argv[2]))) { argv++; argc--; }
+		else break;
+	}
+
 	if (argc != 3){
-		fprintf(stderr, "Have to provide input and output file.\nExample: %s input_file output_file\n", argv[0]);
+		fprintf(stderr, "Have to provide input and output file.\nExample: %s [--stats] [--max-memory size] input_file output_file\n", program);
 		return 0;
 	}
 
+	// root and a node for every entry, under a budget I/O buffers come first
+	unsigned long long io = budget ? 4 * CHUNK : 2ULL * IO_BUFFERS * IO_BUFFER_SIZE;
+	unsigned long long trieSize = DICT_SIZE * sizeof(trie_node);
+	unsigned long long compactSize = sizeof(LzwEncoder) + (CHUNK + 1) * sizeof(lzw_code_t);
+	unsigned long long left = budget > io ? budget - io : 0;
+	int compact = budget && left < trieSize && left >= compactSize;
+	trie_t limit = DICT_SIZE - 1;
+	if (budget && !compact && left < trieSize){
+		if (left < (R + 2) * sizeof(trie_node)){
+			fprintf(stderr, "Memory budget too small, need at least %llu KiB\n",
+				(io + (R + 2) * sizeof(trie_node)) / KiB + 1);
+			return -1;
+		}
+		limit = left / sizeof(trie_node) - 1;
+	}
+
 	FILE* input  = fopen(argv[1], "rb");
 	FILE* output = fopen(argv[2], "wb");
 
 	fprintf(stderr, "Encoding...\n");
-	encode(input, output);
-	fprintf(stderr, "Done!\n");
+	int error;
+	if (compact)     error = encodeCompact(input, output);
+	else if (budget) error = encode(input, output, limit, 2, CHUNK);
+	else             error = encode(input, output, limit, IO_BUFFERS, IO_BUFFER_SIZE);
+	fprintf(stderr, error ? "Failed!\n" : "Done!\n");
+
+	if (budget) budgetReport(budget, io + (compact ? compactSize : (limit + 1ULL) * sizeof(trie_node)), compact ? "hash" : "trie");
+
+#ifdef STATS
+	if (printStatistics) printStats(stdout);
+#else
+	if (printStatistics) fprintf(stderr, "Statistics are not compiled in, rebuild with -DSTATS\n");
+#endif
 
 	fclose(input);
 	fclose(output);
 
-	return 0;
+	return error ? -1 : 0;
 }